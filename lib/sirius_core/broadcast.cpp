@@ -0,0 +1,66 @@
+#include "broadcast.h"
+
+#include <string.h>
+
+ParseResult parseBroadcast(const uint8_t* data, size_t len, BroadcastPacket& out) {
+  if (len < 3 || (data[0] | (data[1] << 8)) != BROADCAST_COMPANY_ID || data[2] != BROADCAST_TAG) {
+    return PARSE_UNKNOWN;
+  }
+  if (len < BROADCAST_HEADER) {
+    return PARSE_TRUNCATED;
+  }
+
+  const uint8_t* command = data + BROADCAST_HEADER;
+  size_t commandLen = len - BROADCAST_HEADER;
+  if (commandLen == 0) {
+    return PARSE_EMPTY;
+  }
+  if (commandLen + 1 > BROADCAST_WRITE_MAX) {
+    return PARSE_INVALID;
+  }
+
+  // コマンドはアドバタイズ1つに過不足なく入っている
+  Command cmd;
+  size_t consumed;
+  ParseResult result = parseBinaryCommand(command, commandLen, cmd, consumed);
+  if (result != PARSE_OK) {
+    return result;
+  }
+  if (consumed != commandLen) {
+    return PARSE_INVALID;
+  }
+
+  out.seq = (uint16_t)(data[3] | (data[4] << 8));
+  out.targets = data[5];
+  out.write[0] = PROTOCOL_MAGIC;
+  memcpy(out.write + 1, command, commandLen);
+  out.writeLen = commandLen + 1;
+  return PARSE_OK;
+}
+
+bool BroadcastFilter::accept(const BroadcastPacket& packet, uint8_t deviceId, uint32_t now) {
+  if (deviceId == 0 || deviceId > 8 || (packet.targets & (1u << (deviceId - 1))) == 0) {
+    return false;
+  }
+
+  if (now - lastSeen_ > BROADCAST_DEDUP_EXPIRE_MS) {
+    historyCount_ = 0;
+    historyNext_ = 0;
+  }
+  lastSeen_ = now;
+
+  for (size_t i = 0; i < historyCount_; i++) {
+    if (history_[i] == packet.seq) {
+      duplicates_++;
+      return false;
+    }
+  }
+
+  history_[historyNext_] = packet.seq;
+  historyNext_ = (historyNext_ + 1) % BROADCAST_DEDUP_HISTORY;
+  if (historyCount_ < BROADCAST_DEDUP_HISTORY) {
+    historyCount_++;
+  }
+  accepted_++;
+  return true;
+}
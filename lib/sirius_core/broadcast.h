@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol.h"
+
+// アドバタイズによる接続なしのコマンド配信
+//
+// ホストはメーカー固有データ（Manufacturer Specific Data）にコマンドを1つ載せて
+// アドバタイズし、スキャンしている全デバイスが同時に受け取る。接続も書き込みも
+// 不要なので、左右の耳（と今後のデバイス）を1回の送信で動かせる。
+//
+// メーカー固有データの形式（リトルエンディアン）:
+//   COMPANY_ID(u16),TAG,SEQ(u16),TARGETS,オペコード,ペイロード
+// オペコード以降はバイナリ形式のコマンドから PROTOCOL_MAGIC を除いたもの。
+// TARGETS は宛先の DEVICE_ID のビット（bit0 が DEVICE_ID 1）。
+// ホストは同じ内容を何度もアドバタイズするので、SEQ が同じものは1回だけ実行する。
+
+// メーカーID（0xFFFF は製品に割り当てられない試験・社内用の値）と識別タグ
+#define BROADCAST_COMPANY_ID 0xFFFF
+#define BROADCAST_TAG 0x53
+#define BROADCAST_HEADER 6
+#define BROADCAST_TARGET_ALL 0xFF
+
+// 1つのアドバタイズで送れる書き込み（PROTOCOL_MAGIC + コマンド）の最大長
+// アドバタイズデータは31バイトで、メーカー固有データはそのうち最大29バイト
+#define BROADCAST_WRITE_MAX 32
+
+// 実行済みとして覚えておく SEQ の数と、覚えておく時間（ミリ秒）
+// この時間アドバタイズが途切れたら忘れるので、ホストを再起動して SEQ が戻っても受け付ける
+#define BROADCAST_DEDUP_HISTORY 8
+#define BROADCAST_DEDUP_EXPIRE_MS 5000
+
+struct BroadcastPacket {
+  uint16_t seq;
+  uint8_t targets;
+  // キャラクタリスティックへの書き込みと同じ形式（PROTOCOL_MAGIC から始まる）
+  uint8_t write[BROADCAST_WRITE_MAX];
+  size_t writeLen;
+};
+
+// メーカー固有データを解析する
+// 別のメーカー・別の用途のデータは PARSE_UNKNOWN、コマンドが不正なら parseBinaryCommand() と同じ結果
+ParseResult parseBroadcast(const uint8_t* data, size_t len, BroadcastPacket& out);
+
+// SEQ による重複の除去と宛先の判定（スキャンのコールバックから呼ぶ）
+class BroadcastFilter {
+public:
+  // deviceId 宛てで、まだ実行していない SEQ なら true を返して実行済みにする
+  bool accept(const BroadcastPacket& packet, uint8_t deviceId, uint32_t now);
+
+  uint32_t acceptedCount() const { return accepted_; }
+  uint32_t duplicateCount() const { return duplicates_; }
+
+private:
+  uint16_t history_[BROADCAST_DEDUP_HISTORY];
+  size_t historyCount_ = 0;
+  size_t historyNext_ = 0;
+  uint32_t lastSeen_ = 0;
+  uint32_t accepted_ = 0;
+  uint32_t duplicates_ = 0;
+};
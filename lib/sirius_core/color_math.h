@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <FastLED.h>
+
+// 色の補間は整数演算のみで行う（ESP32-C6 のRISC-VコアにはFPUがなく、floatはソフトウェア演算になる）
+
+// 進行度の固定小数点表現（0.16: 0 〜 65535 が 0.0 〜 1.0 未満に対応）
+#define PROGRESS_ONE 65536u
+
+// duration のうち elapsed だけ進んだ進行度を 0.16 固定小数点で返す（elapsed < duration）
+inline uint32_t progress16(uint32_t elapsed, uint32_t duration) {
+  // elapsed << 16 が32ビットに収まるよう、長い時間は両方を縮める
+  while (duration >= PROGRESS_ONE) {
+    elapsed >>= 1;
+    duration >>= 1;
+  }
+  // 縮めると elapsed == duration になることがある（例: 131070 / 131071）ので 1.0 未満に抑える
+  uint32_t progress = (elapsed << 16) / duration;
+  return progress < PROGRESS_ONE ? progress : PROGRESS_ONE - 1;
+}
+
+// a から b へ progress（0.16 固定小数点）だけ進んだ値
+inline uint8_t lerp8(uint8_t a, uint8_t b, uint32_t progress) {
+  int32_t diff = (int32_t)b - (int32_t)a;
+  return (uint8_t)(a + ((diff * (int32_t)progress) >> 16));
+}
+
+// from から to へ progress（0.16 固定小数点）だけ進んだ色
+inline CRGB lerpColor16(const CRGB& from, const CRGB& to, uint32_t progress) {
+  return CRGB(lerp8(from.r, to.r, progress),
+              lerp8(from.g, to.g, progress),
+              lerp8(from.b, to.b, progress));
+}
+
+// from から to へ、duration のうち elapsed だけ進んだ色を線形補間で求める
+inline CRGB lerpColor(const CRGB& from, const CRGB& to, uint32_t elapsed, uint32_t duration) {
+  if (elapsed >= duration) {
+    return to;
+  }
+  return lerpColor16(from, to, progress16(elapsed, duration));
+}
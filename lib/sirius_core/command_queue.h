@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// 単一プロデューサ・単一コンシューマのロックフリーリングバッファ
+//
+// プロデューサ（BLEコールバックのタスク）は push() のみ、
+// コンシューマ（loop()）は pop() のみを呼ぶこと。
+// 満杯のときは push() が失敗し、破棄数がカウントされる（BLE側を待たせない）。
+template <typename T, size_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+  // プロデューサ側: 追加できなければ false（破棄数を加算）
+  bool push(const T& item) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    uint32_t tail = tail_.load(std::memory_order_acquire);
+    if (head - tail >= N) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    buffer_[head & (N - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);
+    pushed_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // プロデューサ側: n 個をまとめて追加する（コンシューマからは一度に見える）
+  // 全部は入らなければ何も追加せず false（n 個とも破棄数に加算）
+  bool pushAll(const T* items, size_t n) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    uint32_t tail = tail_.load(std::memory_order_acquire);
+    if (n > N - (head - tail)) {
+      dropped_.fetch_add(n, std::memory_order_relaxed);
+      return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+      buffer_[(head + i) & (N - 1)] = items[i];
+    }
+    head_.store(head + n, std::memory_order_release);
+    pushed_.fetch_add(n, std::memory_order_relaxed);
+    return true;
+  }
+
+  // プロデューサ側: n 個をまとめて積める空きがあるか（なければ n 個とも破棄数に加算して false）
+  // 空きはコンシューマが取り出すほど増えるだけなので、true なら続く pushAll() は成功する
+  bool reserve(size_t n) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    uint32_t tail = tail_.load(std::memory_order_acquire);
+    if (n > N - (head - tail)) {
+      dropped_.fetch_add(n, std::memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+
+  // コンシューマ側: 取り出せなければ false
+  bool pop(T& item) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    uint32_t head = head_.load(std::memory_order_acquire);
+    if (head == tail) {
+      return false;
+    }
+    item = buffer_[tail & (N - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // 現在の要素数（目安）
+  size_t size() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+
+  static constexpr size_t capacity() { return N; }
+
+  // 追加に成功した累計数
+  uint32_t pushedCount() const { return pushed_.load(std::memory_order_relaxed); }
+  // 満杯で破棄した累計数
+  uint32_t droppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  T buffer_[N];
+  std::atomic<uint32_t> head_{0};    // プロデューサのみ更新
+  std::atomic<uint32_t> tail_{0};    // コンシューマのみ更新
+  std::atomic<uint32_t> pushed_{0};
+  std::atomic<uint32_t> dropped_{0};
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "command_queue.h"
+#include "command_scheduler.h"
+#include "frame_codec.h"
+#include "frame_stage.h"
+#include "log.h"
+#include "peer_link.h"
+#include "protocol.h"
+
+// 1回の書き込みを解析したコマンドの並びをまとめてキューに積む
+//
+// ピクセルフレームは受信データから直接ステージへ書き込み、キューには切替通知だけ積む。
+// ステージへの書き込みもキューへの追加もバッチ全体で1回にまとめるので、
+// loop() はバッチの全コマンドを同じフレームの先頭で反映する（途中までのバッチは見えない）。
+// キューにバッチ全体の空きがなければステージにも触らずに PARSE_BUSY を返す。
+// 別のタスクがステージに書き込み中のときも（FrameStage::beginWrite()）バッチ全体を捨てて PARSE_BUSY。
+template <size_t Pixels, size_t QueueSize>
+ParseResult enqueueBatch(CommandBatch& batch, uint32_t arrivalUs,
+                         FrameStage<Pixels>& stage, SpscRing<Command, QueueSize>& queue) {
+  static_assert(Pixels <= DELTA_MAX_PIXELS, "OP_FRAME / OP_FRAME_DELTA address pixels with a 1-byte START");
+  // 範囲外のフレーム・不正な差分があればステージに触る前に全体を捨てる
+  // （ステージを開いた後に失敗すると、endWrite() で途中までのフレームが見えてしまう）
+  bool hasFrame = false;
+  for (size_t i = 0; i < batch.count; i++) {
+    const Command& cmd = batch.commands[i];
+    if (cmd.type == CMD_FRAME && !stage.fits(cmd.start, cmd.count)) {
+      LOG_WARN("ピクセルフレームの範囲外: start=%d count=%d", cmd.start, cmd.count);
+      return PARSE_OUT_OF_RANGE;
+    }
+    if (cmd.type == CMD_FRAME_DELTA && !checkDeltaFrame(cmd.pixels, cmd.count, stage.size())) {
+      LOG_WARN("差分フレームが不正です: %dバイト", cmd.count);
+      return PARSE_INVALID;
+    }
+    hasFrame = hasFrame || cmd.type == CMD_FRAME || cmd.type == CMD_FRAME_DELTA;
+  }
+  // フレームだけ見えて他のコマンドが消えることのないよう、ステージより先に空きを確かめる
+  if (!queue.reserve(batch.count)) {
+    return PARSE_BUSY;
+  }
+
+  if (hasFrame) {
+    if (!stage.beginWrite()) {
+      LOG_WARN("ピクセルフレームの書き込みが重なりました");
+      return PARSE_BUSY;
+    }
+    for (size_t i = 0; i < batch.count; i++) {
+      Command& cmd = batch.commands[i];
+      if (cmd.type == CMD_FRAME) {
+        stage.writeRange(cmd.start, cmd.pixels, cmd.count);
+        cmd.pixels = nullptr;
+      } else if (cmd.type == CMD_FRAME_DELTA) {
+        // 差分はステージ（前フレームの内容）へ直接デコードする（検証済み）
+        applyCheckedDeltaFrame(cmd.pixels, cmd.count, stage.pixels());
+        cmd.type = CMD_FRAME;
+        cmd.pixels = nullptr;
+      }
+    }
+    stage.endWrite();
+  }
+
+  for (size_t i = 0; i < batch.count; i++) {
+    batch.commands[i].arrivalUs = arrivalUs;
+    batch.commands[i].batchEnd = i + 1 == batch.count;
+  }
+  return queue.pushAll(batch.commands, batch.count) ? PARSE_OK : PARSE_BUSY;
+}
+
+// キャラクタリスティックへの1回の書き込みを解析してキューに積む（BLEコールバックから呼ぶ）
+// batch は解析用の作業領域（大きいのでBLEのタスクのスタックに置かず、呼び出し側で持つ）
+template <size_t Pixels, size_t QueueSize>
+ParseResult receiveWrite(const uint8_t* data, size_t len, uint32_t arrivalUs, CommandBatch& batch,
+                         FrameStage<Pixels>& stage, SpscRing<Command, QueueSize>& queue) {
+  // コマンドの解析（先頭バイトでASCII/バイナリを判定）
+  ParseResult result = parseCommandBatch(data, len, batch);
+  if (result != PARSE_OK) {
+    LOG_WARN("コマンド解析エラー: %d", result);
+    return result;
+  }
+  return enqueueBatch(batch, arrivalUs, stage, queue);
+}
+
+// セカンダリ: プライマリから届いたパケットを反映する（loop() から呼ぶ）
+//
+// 転送された書き込みは開始時刻を付けて queue に積み、共有時計はプライマリに合わせる。
+// arrivalUs は遅延計測用の時刻（micros()）。
+// queue は loop() 専用のもの（BLEコールバックのキューとは別）を渡す。
+// ステージには配信を受けたBLEのタスクも書くが、重なったら FrameStage::beginWrite() が後の方を捨てる。
+// batch は解析用の作業領域（大きいので loop() のスタックに置かず、呼び出し側で持つ）。
+template <size_t Pixels, size_t QueueSize, size_t Scheduled>
+void receivePeerPackets(PeerLink& link, uint8_t group, uint32_t arrivalUs, CommandBatch& batch, FrameStage<Pixels>& stage,
+                        SpscRing<Command, QueueSize>& queue, CommandScheduler<Scheduled>& scheduler) {
+  uint8_t data[PEER_PACKET_MAX];
+  size_t len;
+  uint32_t receivedMs;
+  while (link.receive(data, len, receivedMs)) {
+    PeerPacket packet;
+    if (!parsePeerPacket(data, len, group, packet)) {
+      continue;
+    }
+    if (packet.type == PEER_MSG_CLOCK) {
+      // 受信した時点の共有時計 = 送信時の共有時計 + リンクの遅延
+      scheduler.setOffset(packet.time + PEER_LINK_LATENCY_MS - receivedMs);
+      continue;
+    }
+
+    ParseResult result = parseCommandBatch(packet.write, packet.writeLen, batch);
+    if (result != PARSE_OK) {
+      LOG_WARN("転送されたコマンドの解析エラー: %d", result);
+      continue;
+    }
+    for (size_t i = 0; i < batch.count; i++) {
+      Command& cmd = batch.commands[i];
+      if (packet.hasStartAt && !cmd.hasStartAt && isRelayScheduled(cmd.type)) {
+        cmd.hasStartAt = true;
+        cmd.startAt = packet.time;
+      }
+    }
+    result = enqueueBatch(batch, arrivalUs, stage, queue);
+    if (result != PARSE_OK) {
+      LOG_WARN("転送されたコマンドを反映できません: %d", result);
+    }
+  }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol.h"
+
+// 共有時計と、開始時刻を指定されたコマンド（OP_AT）の予約
+//
+// 左右の耳はそれぞれ別の書き込みでコマンドを受け取るので、届く時刻が
+// 送信間隔とBLEの揺れの分だけずれる。ホストは OP_TIME_PING の往復から
+// 各デバイスの millis() とのずれを求めて OP_TIME_SET で共有時計を合わせ、
+// 同じ共有時刻 T を付けたコマンドを両方に送る。
+// 予約したコマンドは T を過ぎた最初のフレームで、T に相当する millis() を
+// 開始時刻として反映するので、フレームの刻みによらず同じミリ秒から始まる。
+//
+// loop() からだけ使う（BLEコールバックからはキュー経由で渡す）。
+
+// 予約を受け付ける開始時刻の範囲（共有時計で今からこのミリ秒先まで）
+// これより先の開始時刻は OP_TIME_SET 前の時刻や古い共有時計によるものとみなして拒否する
+// （開始時刻の比較は int32_t なので、拒否しないと最大で約24日間予約の枠を塞ぐ）
+#define SCHEDULE_AHEAD_MAX_MS 60000
+
+// 開始時刻 startAt が共有時計の現在時刻 syncNow から予約を受け付ける範囲にあるか（過ぎていてもよい）
+inline bool inScheduleWindow(uint32_t startAt, uint32_t syncNow) {
+  return (int32_t)(startAt - syncNow) <= SCHEDULE_AHEAD_MAX_MS;
+}
+
+template <size_t N>
+class CommandScheduler {
+public:
+  // 共有時計 = millis() + offset
+  void setOffset(uint32_t offset) {
+    offset_ = offset;
+    synced_ = true;
+  }
+  uint32_t offset() const { return offset_; }
+  bool synced() const { return synced_; }
+
+  uint32_t syncNow(uint32_t localMs) const { return localMs + offset_; }
+  uint32_t toLocal(uint32_t syncMs) const { return syncMs - offset_; }
+
+  // コマンドを予約する（満杯なら false）
+  bool schedule(const Command& cmd) {
+    if (count_ >= N) {
+      return false;
+    }
+    pending_[count_++] = cmd;
+    return true;
+  }
+
+  // 開始時刻を過ぎたコマンドを1つ取り出す（開始時刻の早い順、同じなら受信順）
+  bool popDue(uint32_t localMs, Command& out) {
+    uint32_t now = syncNow(localMs);
+    size_t due = N;
+    for (size_t i = 0; i < count_; i++) {
+      if ((int32_t)(pending_[i].startAt - now) > 0) {
+        continue;
+      }
+      if (due == N || (int32_t)(pending_[i].startAt - pending_[due].startAt) < 0) {
+        due = i;
+      }
+    }
+    if (due == N) {
+      return false;
+    }
+    out = pending_[due];
+    for (size_t i = due + 1; i < count_; i++) {
+      pending_[i - 1] = pending_[i];
+    }
+    count_--;
+    return true;
+  }
+
+  size_t pending() const { return count_; }
+  // あと何個予約できるか
+  size_t available() const { return N - count_; }
+  void clear() { count_ = 0; }
+
+private:
+  Command pending_[N];
+  size_t count_ = 0;
+  uint32_t offset_ = 0;
+  bool synced_ = false;
+};
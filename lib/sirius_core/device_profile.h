@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "led_strip.h"
+#include "peer_link.h"
+#include "xy_map.h"
+
+// 基板ごとの設定のうち、LEDのチップ・ピンに依存しない部分
+//
+// 実機（src/device_config.h の DeviceConfig）とシミュレータが同じ値を使う。
+// PEER_ROLE は耳どうしの中継（SIRIUS_PEER_RELAY）を有効にしたときの役割。
+
+// 耳（12個ずつのセグメントが4本、各セグメントが1行）
+using EarLayout = StripLayout<4, 12>;
+
+template <int Id>
+struct DeviceProfile {
+  static_assert(Id == 1 || Id == 2, "DEVICE_ID must be set to 1 or 2");
+};
+
+// 基板1
+template <>
+struct DeviceProfile<1> {
+  static constexpr const char* NAME = "Sirius3_LEFT_EAR";
+  static constexpr uint8_t BRIGHTNESS = 255; // 明るさ (0-255)
+  static constexpr PeerRole PEER_ROLE = PEER_ROLE_PRIMARY; // ホストが接続する側
+  using Layout = EarLayout;
+  static constexpr XyWiring WIRING = XY_ROW_MAJOR;
+};
+
+// 基板2
+template <>
+struct DeviceProfile<2> {
+  static constexpr const char* NAME = "Sirius3_RIGHT_EAR";
+  static constexpr uint8_t BRIGHTNESS = 255;
+  static constexpr PeerRole PEER_ROLE = PEER_ROLE_SECONDARY;
+  using Layout = EarLayout;
+  static constexpr XyWiring WIRING = XY_ROW_MAJOR;
+};
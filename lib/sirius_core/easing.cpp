@@ -0,0 +1,91 @@
+#include "easing.h"
+
+namespace {
+
+const int EASING_TABLE_SIZE = 256;
+
+// ---- コンパイル時に使う数学関数（テーブル生成専用） ----
+
+constexpr double kPi = 3.14159265358979323846;
+
+// cos(x)（0 <= x <= kPi）のテイラー展開
+constexpr double cosTaylor(double x) {
+  double term = 1.0;
+  double sum = 1.0;
+  for (int n = 1; n < 20; n++) {
+    term *= -x * x / ((2 * n - 1) * (2 * n));
+    sum += term;
+  }
+  return sum;
+}
+
+// exp(x)（x >= 0）のテイラー展開
+constexpr double expTaylor(double x) {
+  double term = 1.0;
+  double sum = 1.0;
+  for (int n = 1; n < 60; n++) {
+    term *= x / n;
+    sum += term;
+  }
+  return sum;
+}
+
+// 2^(10x - 10)（0 <= x <= 1）
+constexpr double pow2Expo(double x) {
+  return 1.0 / expTaylor((10.0 - 10.0 * x) * 0.69314718055994530942);
+}
+
+// 各カーブ（入力・出力とも 0.0 〜 1.0）
+constexpr double curve(int easing, double x) {
+  switch (easing) {
+    case EASE_IN_QUAD:      return x * x;
+    case EASE_OUT_QUAD:     return 1.0 - (1.0 - x) * (1.0 - x);
+    case EASE_IN_OUT_QUAD:  return x < 0.5 ? 2.0 * x * x : 1.0 - 2.0 * (1.0 - x) * (1.0 - x);
+    case EASE_IN_CUBIC:     return x * x * x;
+    case EASE_OUT_CUBIC:    return 1.0 - (1.0 - x) * (1.0 - x) * (1.0 - x);
+    case EASE_IN_OUT_CUBIC: return x < 0.5 ? 4.0 * x * x * x : 1.0 - 4.0 * (1.0 - x) * (1.0 - x) * (1.0 - x);
+    case EASE_IN_SINE:      return 1.0 - cosTaylor(x * kPi / 2.0);
+    case EASE_OUT_SINE:     return cosTaylor((1.0 - x) * kPi / 2.0);
+    case EASE_IN_OUT_SINE:  return (1.0 - cosTaylor(x * kPi)) / 2.0;
+    case EASE_IN_EXPO:      return x == 0.0 ? 0.0 : pow2Expo(x);
+    case EASE_OUT_EXPO:     return x == 0.0 ? 0.0 : 1.0 - pow2Expo(1.0 - x);
+    case EASE_IN_OUT_EXPO:  return x == 0.0 ? 0.0 : x < 0.5 ? pow2Expo(2.0 * x) / 2.0 : 1.0 - pow2Expo(2.0 - 2.0 * x) / 2.0;
+    default:                return x;
+  }
+}
+
+// テーブル化するカーブ（EASE_LINEAR と EASE_STEP はテーブルを使わない）
+const int FIRST_TABLE_EASING = EASE_IN_QUAD;
+const int TABLE_COUNT = EASING_COUNT - FIRST_TABLE_EASING;
+
+struct EasingTables {
+  uint16_t values[TABLE_COUNT][EASING_TABLE_SIZE];
+
+  constexpr EasingTables() : values() {
+    for (int t = 0; t < TABLE_COUNT; t++) {
+      for (int i = 0; i < EASING_TABLE_SIZE; i++) {
+        double y = curve(FIRST_TABLE_EASING + t, (double)i / EASING_TABLE_SIZE);
+        double scaled = y * PROGRESS_ONE + 0.5;
+        values[t][i] = scaled <= 0.0 ? 0 : scaled >= PROGRESS_ONE - 1 ? PROGRESS_ONE - 1 : (uint16_t)scaled;
+      }
+    }
+  }
+};
+
+// constexpr で生成するので実行時の初期化はなく、フラッシュ上の定数になる
+constexpr EasingTables kEasingTables;
+
+} // namespace
+
+uint32_t applyEasing(uint8_t easing, uint32_t progress) {
+  if (progress >= PROGRESS_ONE) {
+    progress = PROGRESS_ONE - 1; // 表の範囲外を読まない（線形も 1.0 を越えない）
+  }
+  if (easing == EASE_LINEAR || easing >= EASING_COUNT) {
+    return progress;
+  }
+  if (easing == EASE_STEP) {
+    return 0;
+  }
+  return kEasingTables.values[easing - FIRST_TABLE_EASING][progress >> 8];
+}
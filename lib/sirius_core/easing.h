@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <FastLED.h>
+
+#include "color_math.h"
+
+// イージングカーブ
+//
+// 各カーブは 256 エントリの参照テーブル（コンパイル時に生成してフラッシュに置く）で、
+// 進行度（0.16 固定小数点）の上位8ビットで1回引くだけで求まる。
+// 値の並びはタイムラインのキーフレームの補間方法と共通。
+
+enum Easing : uint8_t {
+  EASE_LINEAR = 0,    // 線形
+  EASE_STEP,          // 終点まで開始値を保持
+  EASE_IN_QUAD,
+  EASE_OUT_QUAD,
+  EASE_IN_OUT_QUAD,
+  EASE_IN_CUBIC,
+  EASE_OUT_CUBIC,
+  EASE_IN_OUT_CUBIC,
+  EASE_IN_SINE,
+  EASE_OUT_SINE,
+  EASE_IN_OUT_SINE,
+  EASE_IN_EXPO,
+  EASE_OUT_EXPO,
+  EASE_IN_OUT_EXPO,
+  EASING_COUNT
+};
+
+// 進行度（0.16 固定小数点）にイージングを掛ける（PROGRESS_ONE 以上は 1.0 未満の最大値として扱う）
+uint32_t applyEasing(uint8_t easing, uint32_t progress);
+
+// from から to へ、duration のうち elapsed だけ進んだ色をイージング付きで求める
+inline CRGB easeColor(const CRGB& from, const CRGB& to, uint32_t elapsed, uint32_t duration,
+                      uint8_t easing) {
+  if (elapsed >= duration) {
+    return to;
+  }
+  return lerpColor16(from, to, applyEasing(easing, progress16(elapsed, duration)));
+}
@@ -0,0 +1,77 @@
+#include "effects.h"
+
+#include "color_math.h"
+
+// 消灯色
+static const CRGB EFFECT_OFF_COLOR = CRGB(0, 0, 0);
+
+void EffectEngine::start(const EffectParams& params, const CRGB& initial, uint32_t now) {
+  uint32_t period = params.period;
+  uint32_t fade = params.fade;
+
+  if (params.type == EFFECT_PULSE) {
+    onTime_ = period * 2;
+    offTime_ = period * 3;
+    fadeIn_ = fade * 2;
+    fadeOut_ = fade * 3;
+  } else {
+    onTime_ = period;
+    offTime_ = period;
+    fadeIn_ = fade;
+    fadeOut_ = fade;
+  }
+  // フェードがフェーズより長い場合はフェーズ全体をフェードにする
+  if (fadeIn_ > onTime_) {
+    fadeIn_ = onTime_;
+  }
+  if (fadeOut_ > offTime_) {
+    fadeOut_ = offTime_;
+  }
+
+  type_ = params.type;
+  color_ = params.color;
+  initial_ = initial;
+  cycles_ = params.cycles;
+  startTime_ = now;
+  active_ = (onTime_ + offTime_) > 0;
+}
+
+CRGB EffectEngine::render(uint32_t now) {
+  if (!active_) {
+    return EFFECT_OFF_COLOR;
+  }
+
+  uint32_t elapsed = now - startTime_;
+  uint32_t cycle = elapsed / (onTime_ + offTime_);
+  if (cycles_ != 0 && cycle >= cycles_) {
+    active_ = false;
+    return EFFECT_OFF_COLOR;
+  }
+  return renderLine(now, 0, 1);
+}
+
+CRGB EffectEngine::renderLine(uint32_t now, size_t line, size_t lines) const {
+  if (!active_) {
+    return EFFECT_OFF_COLOR;
+  }
+
+  uint32_t elapsed = now - startTime_;
+  uint32_t cycleTime = onTime_ + offTime_;
+  uint32_t cycle = elapsed / cycleTime;
+  if (cycles_ != 0 && cycle >= cycles_) {
+    return EFFECT_OFF_COLOR;
+  }
+
+  uint32_t phase = elapsed - cycle * cycleTime;
+  if (phase < onTime_) {
+    // 最初のサイクルだけはエフェクト開始時の色からフェードインする
+    const CRGB& from = (cycle == 0) ? initial_ : EFFECT_OFF_COLOR;
+    // 各行（列）の点灯開始をずらす。最後の行もフェーズ内でフェードインし終わるようにする
+    uint32_t lineStart = (uint32_t)((uint64_t)(onTime_ - fadeIn_) * line / lines);
+    if (phase < lineStart) {
+      return from;
+    }
+    return lerpColor(from, color_, phase - lineStart, fadeIn_);
+  }
+  return lerpColor(color_, EFFECT_OFF_COLOR, phase - onTime_, fadeOut_);
+}
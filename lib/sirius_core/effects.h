@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <FastLED.h>
+
+// デバイス内で再生するエフェクト
+//
+// 1サイクルは「点灯フェーズ」と「消灯フェーズ」からなる。
+//   点灯フェーズ: fadeIn ミリ秒かけて消灯色→指定色、残りは指定色を保持
+//   消灯フェーズ: fadeOut ミリ秒かけて指定色→消灯色、残りは消灯色を保持
+// 時刻は millis() から直接計算するので、ホスト側のタイミングの揺れに影響されない。
+//
+// 行・列のエフェクトは点滅と同じ周期で、点灯フェーズの間に行（または列）を
+// 1本ずつずらして点けていく。消灯フェーズは全体がそろって消える。
+
+enum EffectType : uint8_t {
+  EFFECT_BLINK = 0, // 点滅（ウィンカー/ハザード/緊急）: 点灯=消灯=period、フェード=fade
+  EFFECT_PULSE = 1, // フェードイン・アウト（前進/後退）: 点灯=2*period、消灯=3*period、フェード=2*fade/3*fade
+  EFFECT_SWEEP = 2, // 縦方向のスイープ: 上の行から順に点灯、タイミングは点滅と同じ
+  EFFECT_CHASE = 3, // 行に沿ったチェイス（流れるウィンカー）: 左の列から順に点灯
+  EFFECT_CHASE_REVERSE = 4, // EFFECT_CHASE の逆向き（右の列から順に点灯）
+  EFFECT_TYPE_COUNT
+};
+
+// エフェクト開始コマンドのパラメータ
+struct EffectParams {
+  EffectType type;
+  CRGB color;      // 点灯色
+  uint16_t period; // 点滅の間隔（ミリ秒）
+  uint8_t cycles;  // 繰り返し回数（0なら停止コマンドまで無限）
+  uint16_t fade;   // フェード時間（ミリ秒）
+};
+
+class EffectEngine {
+public:
+  // エフェクトを開始する。initial は最初のフェードインの開始色
+  void start(const EffectParams& params, const CRGB& initial, uint32_t now);
+  void stop() { active_ = false; }
+  bool active() const { return active_; }
+
+  // now の時点の色を返す。最後のサイクルが終わったら消灯色を返して停止する
+  // 行・列のエフェクトでは最初の行（列）の色
+  CRGB render(uint32_t now);
+
+  // 行・列のエフェクトで、lines 本のうち line 本目の now の時点の色
+  // （停止の判定は render() で行う）
+  CRGB renderLine(uint32_t now, size_t line, size_t lines) const;
+
+  EffectType type() const { return type_; }
+
+private:
+  EffectType type_ = EFFECT_BLINK;
+  bool active_ = false;
+  CRGB color_;
+  CRGB initial_;
+  uint32_t startTime_ = 0;
+  uint32_t onTime_ = 0;
+  uint32_t offTime_ = 0;
+  uint32_t fadeIn_ = 0;
+  uint32_t fadeOut_ = 0;
+  uint8_t cycles_ = 0;
+};
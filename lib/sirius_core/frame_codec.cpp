@@ -0,0 +1,132 @@
+#include "frame_codec.h"
+
+#include <string.h>
+
+namespace {
+
+// ランとして送る最小の連続画素数（これ未満はリテラルの方が短い）
+const size_t MIN_RUN = 3;
+
+bool sameColor(const CRGB& a, const CRGB& b) {
+  return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+// スパンを1つ読み、範囲とバイト数を確認する。次のスパンの位置を返す（不正なら nullptr）
+const uint8_t* checkSpan(const uint8_t* p, const uint8_t* end, size_t numPixels) {
+  if (end - p < 2) {
+    return nullptr;
+  }
+  size_t start = p[0];
+  size_t count = p[1] & DELTA_COUNT_MAX;
+  bool run = (p[1] & DELTA_RUN_FLAG) != 0;
+  size_t bytes = run ? 3 : count * 3;
+  if (count == 0 || start + count > numPixels || (size_t)(end - p - 2) < bytes) {
+    return nullptr;
+  }
+  return p + 2 + bytes;
+}
+
+// out にスパンを1つ書き出す
+bool putSpan(uint8_t*& out, const uint8_t* end, size_t start, size_t count, bool run,
+             const CRGB* colors) {
+  size_t bytes = 2 + (run ? 3 : count * 3);
+  if ((size_t)(end - out) < bytes) {
+    return false;
+  }
+  *out++ = (uint8_t)start;
+  *out++ = (uint8_t)(run ? (DELTA_RUN_FLAG | count) : count);
+  memcpy(out, colors, run ? 3 : count * 3);
+  out += run ? 3 : count * 3;
+  return true;
+}
+
+} // namespace
+
+bool checkDeltaFrame(const uint8_t* data, size_t len, size_t numPixels) {
+  const uint8_t* end = data + len;
+  for (const uint8_t* p = data; p != end;) {
+    p = checkSpan(p, end, numPixels);
+    if (p == nullptr) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool applyDeltaFrame(const uint8_t* data, size_t len, CRGB* pixels, size_t numPixels) {
+  // 先に全体を検証し、途中までしか適用されない状態を作らない
+  if (!checkDeltaFrame(data, len, numPixels)) {
+    return false;
+  }
+  applyCheckedDeltaFrame(data, len, pixels);
+  return true;
+}
+
+void applyCheckedDeltaFrame(const uint8_t* data, size_t len, CRGB* pixels) {
+  const uint8_t* end = data + len;
+  for (const uint8_t* p = data; p != end;) {
+    size_t start = p[0];
+    size_t count = p[1] & DELTA_COUNT_MAX;
+    if (p[1] & DELTA_RUN_FLAG) {
+      CRGB color(p[2], p[3], p[4]);
+      for (size_t i = 0; i < count; i++) {
+        pixels[start + i] = color;
+      }
+      p += 5;
+    } else {
+      memcpy(&pixels[start], p + 2, count * 3);
+      p += 2 + count * 3;
+    }
+  }
+}
+
+bool encodeDeltaFrame(const CRGB* prev, const CRGB* next, size_t numPixels,
+                      uint8_t* out, size_t outSize, size_t& written) {
+  if (numPixels > DELTA_MAX_PIXELS) {
+    return false;
+  }
+  uint8_t* p = out;
+  const uint8_t* end = out + outSize;
+  size_t i = 0;
+
+  while (i < numPixels) {
+    if (sameColor(prev[i], next[i])) {
+      i++;
+      continue;
+    }
+
+    // 同じ色が MIN_RUN 以上続き、かつ変化していればランにする
+    size_t run = 1;
+    while (i + run < numPixels && run < DELTA_COUNT_MAX && sameColor(next[i + run], next[i])) {
+      run++;
+    }
+    if (run >= MIN_RUN) {
+      if (!putSpan(p, end, i, run, true, &next[i])) {
+        return false;
+      }
+      i += run;
+      continue;
+    }
+
+    // 変化していて、ランが始まらない範囲をリテラルにする
+    size_t count = 1;
+    while (i + count < numPixels && count < DELTA_COUNT_MAX && !sameColor(prev[i + count], next[i + count])) {
+      size_t ahead = 1;
+      while (i + count + ahead < numPixels && ahead < MIN_RUN &&
+             sameColor(next[i + count + ahead], next[i + count])) {
+        ahead++;
+      }
+      if (ahead >= MIN_RUN) {
+        break;
+      }
+      count++;
+    }
+    if (!putSpan(p, end, i, count, false, &next[i])) {
+      return false;
+    }
+    i += count;
+  }
+
+  written = p - out;
+  return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <FastLED.h>
+
+// 差分ピクセルフレームの形式（OP_FRAME_DELTA のペイロード）
+//
+// 前フレームから変化した区間（スパン）を並べたもの。各スパンは
+//   [START][COUNT] (R,G,B)*COUNT       リテラル: COUNT 画素分の色
+//   [START][0x80|COUNT] R,G,B          ラン   : COUNT 画素を同じ色で塗る
+// COUNT は 1〜127。スパンに含まれない画素は前フレームのまま。
+
+#define DELTA_RUN_FLAG  0x80
+#define DELTA_COUNT_MAX 0x7F
+// START は1バイトなので、差分フレームで扱えるのはこの画素数まで
+#define DELTA_MAX_PIXELS 256
+
+// 差分データが numPixels 画素のフレームに適用できるか（全スパンの範囲とバイト数）を確かめる
+bool checkDeltaFrame(const uint8_t* data, size_t len, size_t numPixels);
+
+// 差分データを検証してから pixels（前フレームの内容）に直接適用する
+// 不正なデータなら pixels には一切触れずに false を返す
+bool applyDeltaFrame(const uint8_t* data, size_t len, CRGB* pixels, size_t numPixels);
+
+// checkDeltaFrame() で確かめた差分データを pixels に適用する（検証しない）
+void applyCheckedDeltaFrame(const uint8_t* data, size_t len, CRGB* pixels);
+
+// prev から next への差分データを out に書き出す（written に書き出したバイト数）
+// outSize に収まらない・numPixels が DELTA_MAX_PIXELS を超えるなら false
+bool encodeDeltaFrame(const CRGB* prev, const CRGB* next, size_t numPixels,
+                      uint8_t* out, size_t outSize, size_t& written);
@@ -0,0 +1,362 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "command_queue.h"
+#include "command_receiver.h"
+#include "command_scheduler.h"
+#include "frame_profiler.h"
+#include "frame_scheduler.h"
+#include "frame_stage.h"
+#include "led_controller.h"
+#include "log.h"
+#include "peer_link.h"
+#include "protocol.h"
+#include "show_gate.h"
+#include "stats.h"
+
+// 内容が変わらないフレームでもLEDへ再送する間隔（ミリ秒、0で再送しない）
+#define SHOW_KEEPALIVE_MS 1000
+
+// BLEコールバックからloop()へ渡すコマンドキューの長さ（2のべき乗）
+#define COMMAND_QUEUE_SIZE 32
+
+// セカンダリが転送されたコマンドを loop() 内で受け渡すキューの長さ（2のべき乗）
+#define PEER_QUEUE_SIZE 16
+
+// 開始時刻を指定されたコマンド（OP_AT）を予約できる数
+// 中継のプライマリは1回の書き込みの状態コマンドを全部予約するので、1バッチ分は必ず入るようにする
+#define SCHEDULED_COMMAND_MAX COMMAND_BATCH_MAX
+
+// モードごとの目標フレームレート（fps）
+// 固定色モードは画が変わらないので低めにして処理を空ける
+const uint32_t MODE_FRAME_RATE[] = {
+  60, // MODE_AUTO
+  30, // MODE_FIXED
+  60, // MODE_TRANSITION
+  60, // MODE_STREAM
+  60, // MODE_EFFECT
+  60, // MODE_TIMELINE
+};
+static_assert(sizeof(MODE_FRAME_RATE) / sizeof(MODE_FRAME_RATE[0]) == MODE_COUNT, "MODE_FRAME_RATE must cover every mode");
+
+// FrameEngine が実機・シミュレータに任せる部分（時計・LEDへの送信・応答の通知）
+class FramePlatform {
+public:
+  virtual ~FramePlatform() = default;
+
+  virtual uint32_t nowMs() = 0; // millis()
+  virtual uint32_t nowUs() = 0; // micros()
+
+  // LEDへ送る明るさ（ShowGate の比較に使う）と FastLED.show()
+  virtual uint8_t brightness() = 0;
+  virtual void show() = 0;
+
+  // OP_STATS_REQUEST / OP_TIME_PING の応答（通知するキャラクタリスティックは呼び出し側が持つ）
+  virtual void sendStatsReport(uint8_t report, uint8_t flags) = 0;
+  virtual void sendTimeReply(const Command& cmd) = 0;
+
+  // フレームの区間の区切り（実機は FrameProfiler に記録する）
+  virtual void mark(ProfileStage) {}
+};
+
+// 1フレームの処理（コマンドの反映 → 予約 → 色の計算 → 描画 → LEDへの送信）
+//
+// 実機の loop() とシミュレータが同じものを使うので、反映の順序・予約・中継・
+// 送信の省略はどちらでも同じに動く。Strip は LedStrip、Map は XyMap。
+// receiveHostWrite()/receiveBroadcast() はBLEのタスク、それ以外は loop() から呼ぶ。
+template <typename Strip, typename Map>
+class FrameEngine {
+public:
+  FrameEngine() : showGate_(SHOW_KEEPALIVE_MS), frameScheduler_(MODE_FRAME_RATE[MODE_AUTO]) {}
+
+  // 耳どうしの中継（peer_link.h）の役割と通信路（link が nullptr なら中継しない）
+  void setPeer(PeerLink* link, PeerRole role, uint8_t group) {
+    peerLink_ = link;
+    peerRole_ = link ? role : PEER_ROLE_NONE;
+    peerGroup_ = group;
+  }
+  PeerRole peerRole() const { return peerRole_; }
+
+  // 0 以外ならモードに関係なくこのフレームレートで刻む（シミュレータの --fps）
+  void setFixedFps(uint32_t fps) { fixedFps_ = fps; }
+
+  // BLEのタスク: ホストからの1回の書き込みを受け取る（制御用・ストリームのコールバックから呼ぶ）
+  // プライマリは開始時刻を付けて自分のキューに積み、積めたときだけセカンダリへ転送する
+  // （自分が捨てた書き込みをセカンダリだけが反映して、左右の状態がずれないように）
+  // 共有時計のオフセットは loop() で書き換わるが、u32 の読み出しは分割されない
+  ParseResult receiveHostWrite(const uint8_t* data, size_t len, uint32_t arrivalUs, uint32_t nowMs) {
+    if (peerRole_ != PEER_ROLE_PRIMARY) {
+      return receiveWrite(data, len, arrivalUs, writeBatch_, frameStage_, commandQueue_);
+    }
+    ParseResult result = parseCommandBatch(data, len, writeBatch_);
+    if (result != PARSE_OK) {
+      LOG_WARN("コマンド解析エラー: %d", result);
+      return result;
+    }
+    uint32_t startAt = scheduler_.syncNow(nowMs) + PEER_RELAY_LEAD_MS;
+    bool stamped = stampRelayBatch(writeBatch_, startAt);
+    result = enqueueBatch(writeBatch_, arrivalUs, frameStage_, commandQueue_);
+    if (result == PARSE_OK) {
+      relayBatch(*peerLink_, peerGroup_, data, writeBatch_, stamped, startAt);
+    }
+    return result;
+  }
+
+  // BLEのタスク: アドバタイズで配信された書き込みを受け取る（両方の耳が受け取るので転送しない）
+  ParseResult receiveBroadcast(const uint8_t* data, size_t len, uint32_t arrivalUs) {
+    return receiveWrite(data, len, arrivalUs, writeBatch_, frameStage_, commandQueue_);
+  }
+
+  // loop(): 1フレームを処理する。LEDへ送ったら true
+  bool runFrame(FramePlatform& platform) {
+    // 受信したコマンドを反映（以降このフレームでは状態が変わらない）
+    drainCommands(platform);
+    platform.mark(PROFILE_DRAIN);
+
+    // 現在のモードの色を計算
+    controller_.update(platform.nowMs());
+    platform.mark(PROFILE_EFFECT);
+
+    // LEDに反映（ピクセルフレームモードは新しいフレームがあればラッチし、なければ前のフレームを維持）
+    if (controller_.mode() == MODE_STREAM) {
+      frameStage_.latch(leds_.pixels());
+    } else {
+      controller_.compose<Map>(leds_);
+    }
+    platform.mark(PROFILE_COMPOSE);
+
+    // LEDを更新（前回と同じフレームなら送らない）
+    bool shown = showGate_.shouldShow(leds_.pixels(), platform.brightness(), platform.nowMs());
+    if (shown) {
+      platform.show();
+      recordShowLatency(platform.nowUs());
+    }
+    pendingCount_ = 0; // 送らなかったフレームのコマンドは画を変えていないので数えない
+    platform.mark(PROFILE_SHOW);
+    return shown;
+  }
+
+  // loop(): フレームの最後に呼ぶ。次のフレームの開始時刻（micros()）を返す
+  uint32_t finishFrame(uint32_t nowUs) {
+    frameScheduler_.setFps(fixedFps_ ? fixedFps_ : MODE_FRAME_RATE[controller_.mode()]);
+    return frameScheduler_.finishFrame(nowUs);
+  }
+
+  // LEDの出力先（実機は setup() で FastLED に登録する）
+  Strip& leds() { return leds_; }
+  const Strip& leds() const { return leds_; }
+  const LedController& controller() const { return controller_; }
+  const CommandScheduler<SCHEDULED_COMMAND_MAX>& scheduler() const { return scheduler_; }
+  const SpscRing<Command, COMMAND_QUEUE_SIZE>& commandQueue() const { return commandQueue_; }
+  const ShowGate<Strip::SIZE>& showGate() const { return showGate_; }
+  const FrameScheduler& frameScheduler() const { return frameScheduler_; }
+
+  // コマンドの遅延（マイクロ秒）
+  const Log2Histogram& latencyQueue() const { return latencyQueue_; } // 受信 → loop()での反映
+  // 以下の2つはLEDへ送ったフレームのコマンドだけ。予約コマンドは開始時刻に反映したときから数える
+  const Log2Histogram& latencyShow() const { return latencyShow_; }   // loop()での反映 → LEDへの送信
+  const Log2Histogram& latencyTotal() const { return latencyTotal_; } // 受信 → LEDへの送信
+  void resetLatency() {
+    latencyQueue_.reset();
+    latencyShow_.reset();
+    latencyTotal_.reset();
+  }
+
+private:
+  // 解析済みコマンドを反映する（now はコマンドの開始時刻、millis() の値）
+  void applyCommand(FramePlatform& platform, const Command& cmd, uint32_t now) {
+    switch (cmd.type) {
+      case CMD_STATS_REQUEST:
+        platform.sendStatsReport(cmd.report, cmd.flags);
+        break;
+      case CMD_TIME_PING:
+        platform.sendTimeReply(cmd);
+        break;
+      case CMD_TIME_SET:
+        scheduler_.setOffset(cmd.time);
+        LOG_INFO("共有時計を設定: オフセット=%uミリ秒", cmd.time);
+        if (peerRole_ == PEER_ROLE_PRIMARY) {
+          sendPeerClock(platform.nowMs()); // セカンダリもすぐに合わせる
+        }
+        break;
+      default:
+        controller_.apply(cmd, now);
+        break;
+    }
+  }
+
+  // キューに溜まったコマンドを全て反映する（フレームの先頭で1回だけ呼ぶ）
+  // バッチは pushAll() で積まれるので、キューには途中までのバッチはない
+  template <size_t QueueSize>
+  void drainQueue(FramePlatform& platform, SpscRing<Command, QueueSize>& queue) {
+    size_t count = 0;
+    while (queue.pop(drained_[count])) {
+      const Command& cmd = drained_[count++];
+      latencyQueue_.record(platform.nowUs() - cmd.arrivalUs);
+      if (cmd.batchEnd || count == COMMAND_BATCH_MAX) {
+        applyBatch(platform, drained_, count);
+        count = 0;
+      }
+    }
+  }
+
+  // 1回の書き込みのコマンドを反映する（開始時刻付きは予約する）
+  //
+  // すぐに反映する画を変えるコマンドと OP_TIME_SET は、前の書き込みの予約を取り消す
+  // （後から届いた指示が優先。共有時計が変われば古い開始時刻は意味を持たない）。
+  // 予約がバッチの途中で失敗すると一部だけ反映されるので、共有時計が未設定・
+  // 開始時刻が SCHEDULE_AHEAD_MAX_MS より先・入りきらないときはバッチ全体を捨てる。
+  void applyBatch(FramePlatform& platform, const Command* commands, size_t count) {
+    size_t scheduled = 0;
+    bool cancel = false;
+    for (size_t i = 0; i < count; i++) {
+      const Command& cmd = commands[i];
+      if (cmd.hasStartAt) {
+        scheduled++;
+      } else {
+        cancel = cancel || cmd.type == CMD_TIME_SET || cancelsSchedule(cmd.type);
+      }
+    }
+    if (scheduled > 0 && !checkSchedule(platform, commands, count, cancel, scheduled)) {
+      return;
+    }
+    if (cancel && scheduler_.pending() > 0) {
+      LOG_INFO("予約コマンドを取り消しました: %d個", scheduler_.pending());
+      scheduler_.clear();
+    }
+    for (size_t i = 0; i < count; i++) {
+      if (commands[i].hasStartAt) {
+        scheduler_.schedule(commands[i]);
+      } else {
+        addPending(commands[i].arrivalUs, platform.nowUs());
+        applyCommand(platform, commands[i], platform.nowMs());
+      }
+    }
+  }
+
+  // すぐに反映すると前の書き込みの予約を取り消すコマンド（画を変えるもの）
+  static bool cancelsSchedule(CommandType type) {
+    return isRelayScheduled(type) || type == CMD_FRAME || type == CMD_FRAME_DELTA;
+  }
+
+  // バッチの予約コマンドを受け付けられるか（OP_TIME_SET と予約の取り消しは反映した後として数える）
+  bool checkSchedule(FramePlatform& platform, const Command* commands, size_t count, bool cancel,
+                     size_t scheduled) {
+    // プライマリの時計は OP_TIME_SET までは組の共有時計の基準なので、設定済みとして扱う
+    bool synced = scheduler_.synced() || peerRole_ == PEER_ROLE_PRIMARY;
+    uint32_t offset = scheduler_.offset();
+    for (size_t i = 0; i < count; i++) {
+      if (commands[i].type == CMD_TIME_SET) {
+        offset = commands[i].time;
+        synced = true;
+      }
+    }
+    if (!synced) {
+      LOG_WARN("共有時計が未設定なので予約コマンドのバッチを捨てました: %d個", count);
+      return false;
+    }
+    uint32_t syncNow = platform.nowMs() + offset;
+    for (size_t i = 0; i < count; i++) {
+      if (commands[i].hasStartAt && !inScheduleWindow(commands[i].startAt, syncNow)) {
+        LOG_WARN("開始時刻が先すぎるのでバッチを捨てました: startAt=%u", commands[i].startAt);
+        return false;
+      }
+    }
+    if (scheduled > (cancel ? SCHEDULED_COMMAND_MAX : scheduler_.available())) {
+      LOG_WARN("予約コマンドが溢れたのでバッチを捨てました: %d個（予約済み %d個）", count, scheduler_.pending());
+      return false;
+    }
+    return true;
+  }
+
+  void drainCommands(FramePlatform& platform) {
+    drainQueue(platform, commandQueue_);
+
+    if (peerRole_ == PEER_ROLE_SECONDARY) {
+      receivePeerPackets(*peerLink_, peerGroup_, platform.nowUs(), peerBatch_, frameStage_, peerQueue_, scheduler_);
+      drainQueue(platform, peerQueue_);
+    } else if (peerRole_ == PEER_ROLE_PRIMARY &&
+               (!peerClockSent_ || platform.nowMs() - lastPeerClock_ >= PEER_CLOCK_INTERVAL_MS)) {
+      // 最初のフレームでも送る（セカンダリは共有時計を受け取るまで予約コマンドを受け付けない）
+      sendPeerClock(platform.nowMs());
+    }
+
+    // 開始時刻を過ぎた予約コマンドを、開始時刻ちょうどに始めたものとして反映する
+    Command cmd;
+    while (scheduler_.popDue(platform.nowMs(), cmd)) {
+      // 開始時刻まで待ったのは指定どおりなので、遅延は反映したときから数える
+      uint32_t appliedUs = platform.nowUs();
+      addPending(appliedUs, appliedUs);
+      applyCommand(platform, cmd, scheduler_.toLocal(cmd.startAt));
+    }
+
+    uint32_t dropped = commandQueue_.droppedCount();
+    if (dropped != reportedDropCount_) {
+      LOG_WARN("コマンドキューが溢れました: 破棄数=%u", dropped);
+      reportedDropCount_ = dropped;
+    }
+  }
+
+  // プライマリ: 共有時計をセカンダリへ送る
+  void sendPeerClock(uint32_t nowMs) {
+    uint8_t packet[PEER_PACKET_MAX];
+    size_t len = encodePeerClock(packet, peerGroup_, scheduler_.syncNow(nowMs));
+    peerLink_->send(packet, len);
+    lastPeerClock_ = nowMs;
+    peerClockSent_ = true;
+  }
+
+  // このフレームで反映したコマンドを覚えておく（arrivalUs は受信時刻、appliedUs は反映した時刻）
+  void addPending(uint32_t arrivalUs, uint32_t appliedUs) {
+    if (pendingCount_ < COMMAND_QUEUE_SIZE) {
+      pendingArrivals_[pendingCount_] = arrivalUs;
+      pendingConsumed_[pendingCount_] = appliedUs;
+      pendingCount_++;
+    }
+  }
+
+  // このフレームで反映したコマンドの表示までの遅延を記録する（LEDへ送った後に呼ぶ）
+  void recordShowLatency(uint32_t shownUs) {
+    for (size_t i = 0; i < pendingCount_; i++) {
+      latencyShow_.record(shownUs - pendingConsumed_[i]);
+      latencyTotal_.record(shownUs - pendingArrivals_[i]);
+    }
+  }
+
+  Strip leds_;
+  LedController controller_;
+  // 前回送ったフレームと同じならLEDへの送信を省略する
+  ShowGate<Strip::SIZE> showGate_;
+  // フレーム周期（絶対時刻の締め切りで刻む）
+  FrameScheduler frameScheduler_;
+  uint32_t fixedFps_ = 0;
+
+  // BLEのタスク（プロデューサ）から loop()（コンシューマ）へのコマンドキュー
+  SpscRing<Command, COMMAND_QUEUE_SIZE> commandQueue_;
+  // 書き込みの解析用（BLEのタスクからだけ使う）
+  CommandBatch writeBatch_;
+  // ホストから受信したピクセルフレーム（loop()でleds[]にラッチする）
+  FrameStage<Strip::SIZE> frameStage_;
+  uint32_t reportedDropCount_ = 0; // 最後に報告した破棄数
+  Command drained_[COMMAND_BATCH_MAX]; // drainQueue() で取り出したバッチ（loop() のスタックに置かない）
+  // 共有時計と開始時刻を指定されたコマンド（左右の耳で同じミリ秒に始める）
+  CommandScheduler<SCHEDULED_COMMAND_MAX> scheduler_;
+
+  // 耳どうしの中継
+  PeerLink* peerLink_ = nullptr;
+  PeerRole peerRole_ = PEER_ROLE_NONE;
+  uint8_t peerGroup_ = 0;
+  SpscRing<Command, PEER_QUEUE_SIZE> peerQueue_; // セカンダリ: 転送されたコマンド（loop() 専用）
+  CommandBatch peerBatch_;                       // セカンダリ: 転送された書き込みの解析用（loop() 専用）
+  uint32_t lastPeerClock_ = 0;                   // プライマリ: 最後に共有時計を送った時刻
+  bool peerClockSent_ = false;                   // プライマリ: 共有時計を1回でも送ったか
+
+  Log2Histogram latencyQueue_;
+  Log2Histogram latencyShow_;
+  Log2Histogram latencyTotal_;
+  uint32_t pendingArrivals_[COMMAND_QUEUE_SIZE]; // このフレームで反映したコマンドの受信時刻（予約コマンドは反映した時刻）
+  uint32_t pendingConsumed_[COMMAND_QUEUE_SIZE]; // このフレームで反映した時刻
+  size_t pendingCount_ = 0;
+};
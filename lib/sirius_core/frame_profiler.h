@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+#include "stats.h"
+
+// loop() の1フレームの区間別の所要時間
+enum ProfileStage : uint8_t {
+  PROFILE_DRAIN = 0, // 接続管理とコマンドの反映
+  PROFILE_EFFECT,    // エフェクト・タイムライン・遷移の色計算
+  PROFILE_COMPOSE,   // fill_solid / フレームのラッチ
+  PROFILE_SHOW,      // 変化の判定と FastLED.show()
+  PROFILE_LOG,       // 統計とログの出力
+  PROFILE_IDLE,      // 次のフレームの締め切りまでの待ち
+  PROFILE_STAGE_COUNT
+};
+
+// フレームの区間ごとの所要時間を log2 ヒストグラムに集計する
+//
+// 時刻は呼び出し側が渡す（実機ではCPUのサイクルカウンタ）。
+// mark() は前回の mark() からの経過を記録するだけなので、
+// フレームあたりのコストはカウンタ読み出しとバケット加算の数回で済む。
+class FrameProfiler {
+public:
+  // フレームの先頭で呼ぶ（前のフレーム全体の時間を記録する）
+  void beginFrame(uint32_t now) {
+    if (started_) {
+      frame_.record(now - frameStart_);
+    }
+    started_ = true;
+    frameStart_ = now;
+    last_ = now;
+  }
+
+  // 直前の mark() からここまでを stage の時間として記録する
+  void mark(ProfileStage stage, uint32_t now) {
+    stages_[stage].record(now - last_);
+    last_ = now;
+  }
+
+  void reset() {
+    for (uint8_t i = 0; i < PROFILE_STAGE_COUNT; i++) {
+      stages_[i].reset();
+    }
+    frame_.reset();
+  }
+
+  const Log2Histogram& stage(ProfileStage stage) const { return stages_[stage]; }
+  const Log2Histogram& frame() const { return frame_; }
+
+private:
+  Log2Histogram stages_[PROFILE_STAGE_COUNT];
+  Log2Histogram frame_;
+  uint32_t frameStart_ = 0;
+  uint32_t last_ = 0;
+  bool started_ = false;
+};
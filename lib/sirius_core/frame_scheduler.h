@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+
+// 絶対時刻の締め切りでフレーム周期を刻むスケジューラ
+//
+// 「処理が終わってから一定時間待つ」のではなく、フレームの開始時刻を
+// period ごとの絶対時刻（micros()）で決めるので、処理時間が変わっても周期がずれない。
+// 締め切りに間に合わなかった場合は超過として数え、1周期以上遅れたら今から数え直す。
+class FrameScheduler {
+public:
+  explicit FrameScheduler(uint32_t fps) { setFps(fps); }
+
+  // 目標フレームレートを変更する（次の締め切りから反映）
+  void setFps(uint32_t fps) {
+    if (fps == 0) {
+      fps = 1;
+    }
+    period_ = 1000000u / fps;
+    fps_ = fps;
+  }
+  uint32_t fps() const { return fps_; }
+  uint32_t period() const { return period_; }
+
+  // フレームの処理が終わったときに呼ぶ。次のフレームの開始時刻（micros()）を返す
+  uint32_t finishFrame(uint32_t nowUs) {
+    if (!started_) {
+      deadline_ = nowUs;
+      started_ = true;
+    }
+    deadline_ += period_;
+
+    int32_t slack = (int32_t)(deadline_ - nowUs);
+    if (slack < 0) {
+      uint32_t late = (uint32_t)(-slack);
+      overrunCount_++;
+      if (late > maxOverrun_) {
+        maxOverrun_ = late;
+      }
+      if (late >= period_) {
+        // 1周期以上遅れたら取り戻そうとせず、今から周期を数え直す
+        deadline_ = nowUs;
+      }
+      lastSlack_ = 0;
+    } else {
+      lastSlack_ = (uint32_t)slack;
+    }
+    return deadline_;
+  }
+
+  uint32_t deadline() const { return deadline_; }
+  // 直前のフレームの余り時間（マイクロ秒）
+  uint32_t lastSlack() const { return lastSlack_; }
+  // 締め切りを超過したフレーム数と最大超過時間（マイクロ秒）
+  uint32_t overrunCount() const { return overrunCount_; }
+  uint32_t maxOverrun() const { return maxOverrun_; }
+
+private:
+  uint32_t fps_ = 0;
+  uint32_t period_ = 0;
+  uint32_t deadline_ = 0;
+  bool started_ = false;
+  uint32_t lastSlack_ = 0;
+  uint32_t overrunCount_ = 0;
+  uint32_t maxOverrun_ = 0;
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <FastLED.h>
+
+// ホストから送られたピクセルフレームの受け渡しバッファ
+//
+// BLEコールバック（書き込み側）がピクセルを書き込み、loop()（読み出し側）が
+// 次の FastLED.show() の前に leds[] へラッチする。
+// シーケンスロックで保護するので書き込み側は待たされず、読み出し側は
+// 書き込み途中のフレームを検出したら次のフレームで取り直す。
+// 書き込み側は複数のタスクでもよい（セカンダリは loop() の転送とBLEのタスクの配信の両方が書く）。
+// 別のタスクが書き込み中なら beginWrite() は待たずに失敗し、その書き込みは捨てる
+// （1コアでは待つと先に書き始めたタスクに戻れないため）。
+template <size_t N>
+class FrameStage {
+public:
+  // 書き込み側: start から count 画素分のRGB（3バイトずつ）を書き込む
+  // 範囲外、または別のタスクが書き込み中なら false
+  bool write(size_t start, const uint8_t* rgb, size_t count) {
+    if (!fits(start, count) || !beginWrite()) {
+      return false;
+    }
+    writeRange(start, rgb, count);
+    endWrite();
+    return true;
+  }
+
+  // 書き込み側: start から count 画素が範囲内か
+  static constexpr bool fits(size_t start, size_t count) {
+    return start <= N && count <= N - start;
+  }
+
+  // 書き込み側: 直接書き込む場合は beginWrite()/endWrite() で囲む
+  // 複数の書き込みを1回の beginWrite()/endWrite() で囲むと、読み出し側には全部まとめて見える
+  // 別のタスクが書き込み中なら false（endWrite() は呼ばない）
+  bool beginWrite() {
+    uint32_t seq = seq_.load(std::memory_order_relaxed);
+    if ((seq & 1) || !seq_.compare_exchange_strong(seq, seq + 1, std::memory_order_relaxed)) {
+      busyCount_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    return true;
+  }
+  void endWrite() {
+    seq_.store(seq_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+  CRGB* pixels() { return pixels_; }
+  // beginWrite()/endWrite() の中で使う（範囲は fits() で確認しておく）
+  void writeRange(size_t start, const uint8_t* rgb, size_t count) {
+    memcpy(&pixels_[start], rgb, count * sizeof(CRGB));
+  }
+
+  // 読み出し側: 新しいフレームがあれば dst にコピーして true
+  bool latch(CRGB* dst) {
+    for (int attempt = 0; attempt < LATCH_RETRIES; attempt++) {
+      uint32_t before = seq_.load(std::memory_order_acquire);
+      if (before == latchedSeq_) {
+        return false; // 更新なし
+      }
+      if (before & 1) {
+        continue; // 書き込み中
+      }
+      memcpy(dst, pixels_, sizeof(pixels_));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq_.load(std::memory_order_relaxed) == before) {
+        latchedSeq_ = before;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static constexpr size_t size() { return N; }
+
+  // 別のタスクが書き込み中で捨てた書き込みの累計数
+  uint32_t busyCount() const { return busyCount_.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr int LATCH_RETRIES = 3;
+
+  CRGB pixels_[N];
+  std::atomic<uint32_t> seq_{0}; // 奇数なら書き込み中
+  uint32_t latchedSeq_ = 0;      // 読み出し側のみ
+  std::atomic<uint32_t> busyCount_{0};
+};
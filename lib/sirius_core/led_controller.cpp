@@ -0,0 +1,183 @@
+#include "led_controller.h"
+
+#include "log.h"
+
+void LedController::stopAnimations() {
+  effect_.stop();
+  timeline_.stop();
+}
+
+void LedController::apply(const Command& cmd, uint32_t now) {
+  switch (cmd.type) {
+    case CMD_COLOR:
+      stopAnimations();
+      currentColor_ = CRGB(cmd.r, cmd.g, cmd.b);
+      autoHueChange_ = false;
+      isTransitioning_ = false; // 即時変更なので遷移をキャンセル
+      colorMode_ = MODE_FIXED;  // 固定色モードに設定
+      LOG_INFO("色を設定: R=%d, G=%d, B=%d", cmd.r, cmd.g, cmd.b);
+      break;
+
+    case CMD_HUE:
+      stopAnimations();
+      hue_ = cmd.hue;
+      autoHueChange_ = false;
+      isTransitioning_ = false; // 即時変更なので遷移をキャンセル
+      colorMode_ = MODE_FIXED;  // 固定色モードに設定（H:は固定色の一種）
+      LOG_INFO("色相を設定: %d", cmd.hue);
+      break;
+
+    case CMD_MODE:
+      stopAnimations();
+      autoHueChange_ = (cmd.mode == 1);
+      isTransitioning_ = false; // モード変更時は遷移をキャンセル
+      colorMode_ = autoHueChange_ ? MODE_AUTO : MODE_FIXED;  // 自動モードと固定モードを切り替え
+      if (autoHueChange_) {
+        LOG_INFO("モードを設定: 自動色相変化");
+      } else {
+        LOG_INFO("モードを設定: 固定色");
+      }
+      break;
+
+    case CMD_TRANSITION:
+      // T:R,G,B,TIME[,EASING] で、現在の色から指定色に TIME ミリ秒かけて遷移
+      // 遷移パラメータを設定 - 常に現在の色から開始（遷移中でも）
+      stopAnimations();
+      startColor_ = currentColor_; // 現在の色を開始色に（遷移中の色も含む）
+      targetColor_ = CRGB(cmd.r, cmd.g, cmd.b); // 目標色を設定
+      transitionDuration_ = cmd.hasDuration ? cmd.duration : DEFAULT_TRANSITION_TIME; // 時間が省略されていればデフォルト値を使用
+      transitionEasing_ = cmd.easing; // イージング（省略時は線形）
+      transitionStartTime_ = now; // 現在時刻を記録
+      isTransitioning_ = true; // 遷移モードを有効に
+      autoHueChange_ = false; // 自動色相変化を無効に
+      colorMode_ = MODE_TRANSITION;  // 遷移モードに設定
+
+      if (startColor_.r == targetColor_.r && startColor_.g == targetColor_.g && startColor_.b == targetColor_.b) {
+        // 開始色と目標色が同じ場合は遷移不要
+        isTransitioning_ = false;
+        LOG_INFO("開始色と目標色が同じため、遷移はスキップされます");
+      } else {
+        LOG_INFO("色遷移開始: 現在色(R=%d,G=%d,B=%d)から目標色(R=%d,G=%d,B=%d)へ %dミリ秒で遷移",
+                 startColor_.r, startColor_.g, startColor_.b,
+                 targetColor_.r, targetColor_.g, targetColor_.b,
+                 transitionDuration_);
+      }
+      break;
+
+    case CMD_FRAME:
+      // ピクセルは受信時にステージへ書き込み済み。呼び出し側が次のフレームでラッチする
+      stopAnimations();
+      autoHueChange_ = false;
+      isTransitioning_ = false;
+      if (colorMode_ != MODE_STREAM) {
+        colorMode_ = MODE_STREAM;
+        LOG_INFO("ピクセルフレームモードに切り替え");
+      }
+      break;
+
+    case CMD_EFFECT: {
+      // エフェクト開始 - 現在の色（遷移中の色も含む）から最初のフェードインを始める
+      EffectParams params;
+      params.type = (EffectType)cmd.effect;
+      params.color = CRGB(cmd.r, cmd.g, cmd.b);
+      params.period = cmd.period;
+      params.cycles = cmd.cycles;
+      params.fade = cmd.fade;
+      timeline_.stop();
+      effect_.start(params, currentColor_, now);
+      autoHueChange_ = false;
+      isTransitioning_ = false;
+      colorMode_ = MODE_EFFECT;
+      LOG_INFO("エフェクト開始: 種類=%d 色(R=%d,G=%d,B=%d) 間隔=%dミリ秒 回数=%d フェード=%dミリ秒",
+               cmd.effect, cmd.r, cmd.g, cmd.b, cmd.period, cmd.cycles, cmd.fade);
+      break;
+    }
+
+    case CMD_TIMELINE_CLEAR:
+      timeline_.clear();
+      if (colorMode_ == MODE_TIMELINE) {
+        colorMode_ = MODE_FIXED; // 再生中の色のまま固定
+      }
+      LOG_INFO("タイムラインを消去");
+      break;
+
+    case CMD_TIMELINE_KEY: {
+      Keyframe keyframe;
+      keyframe.time = cmd.time;
+      keyframe.color = CRGB(cmd.r, cmd.g, cmd.b);
+      keyframe.easing = cmd.easing;
+      if (!timeline_.append(keyframe)) {
+        LOG_WARN("キーフレームを追加できません: 時刻=%uミリ秒 登録数=%d", cmd.time, timeline_.size());
+      }
+      break;
+    }
+
+    case CMD_TIMELINE_PLAY:
+      effect_.stop();
+      if (timeline_.play(now, (cmd.flags & TIMELINE_FLAG_LOOP) != 0)) {
+        autoHueChange_ = false;
+        isTransitioning_ = false;
+        colorMode_ = MODE_TIMELINE;
+        LOG_INFO("タイムライン再生開始: キーフレーム数=%d", timeline_.size());
+      } else {
+        LOG_WARN("タイムラインが空です");
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+void LedController::update(uint32_t now) {
+  frameTime_ = now;
+
+  // エフェクト再生
+  if (colorMode_ == MODE_EFFECT) {
+    currentColor_ = effect_.render(now);
+    if (!effect_.active()) {
+      // 再生完了後は消灯色の固定色モードに戻る
+      colorMode_ = MODE_FIXED;
+      LOG_INFO("エフェクト完了");
+    }
+  }
+  // タイムライン再生
+  else if (colorMode_ == MODE_TIMELINE) {
+    currentColor_ = timeline_.render(now);
+    if (!timeline_.playing()) {
+      // 再生完了後は最後のキーフレームの色で固定色モードに戻る
+      colorMode_ = MODE_FIXED;
+      LOG_INFO("タイムライン再生完了");
+    }
+  }
+  // 色遷移処理
+  else if (isTransitioning_) {
+    uint32_t elapsedTime = now - transitionStartTime_;
+    if (elapsedTime >= transitionDuration_) {
+      // 遷移完了
+      currentColor_ = targetColor_;
+      isTransitioning_ = false;
+      // ここでモードは変更しない（colorMode_ = MODE_TRANSITIONのまま）
+      LOG_INFO("色遷移完了");
+    } else {
+      // 遷移中 - イージングを掛けて現在の色を計算
+      currentColor_ = easeColor(startColor_, targetColor_, elapsedTime, transitionDuration_, transitionEasing_);
+    }
+  }
+  // 自動色相変化モード
+  else if (colorMode_ == MODE_AUTO) {
+    if (now - lastHueStep_ >= AUTO_HUE_STEP_MS) {
+      lastHueStep_ = now;
+      hue_++; // 色相を緩やかに変化
+    }
+  }
+}
+
+CRGB LedController::frameColor() const {
+  if (colorMode_ == MODE_AUTO) {
+    return CHSV(hue_, 255, 255);
+  }
+  // 固定色・遷移・エフェクト・タイムラインは現在の色で全LEDを設定
+  // 色相による色の使用は廃止し、常に指定されたRGB値を使用する
+  return currentColor_;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <FastLED.h>
+
+#include "easing.h"
+#include "effects.h"
+#include "protocol.h"
+#include "timeline.h"
+
+// 色遷移のデフォルト時間（ミリ秒）
+#define DEFAULT_TRANSITION_TIME 1000
+
+// 自動色相変化モードで色相を1進める間隔（ミリ秒）
+#define AUTO_HUE_STEP_MS 20
+
+// 色設定モードの定義
+enum ColorMode {
+  MODE_AUTO,      // 自動色相変化モード
+  MODE_FIXED,     // 固定色モード（C:コマンド）
+  MODE_TRANSITION, // 遷移モード（T:コマンド）
+  MODE_STREAM,     // ピクセルフレームモード（ホストが描画したフレームを表示）
+  MODE_EFFECT,     // エフェクト再生モード（E:コマンド）
+  MODE_TIMELINE,   // キーフレームタイムライン再生モード
+  MODE_COUNT
+};
+
+// コマンドによる色・モードの状態と、フレームごとの色の計算
+//
+// ハードウェア（BLE・LEDの送信・時計）には触れず、時刻は呼び出し側が渡す。
+// loop() では apply() → update() → compose() の順に呼び、
+// MODE_STREAM のときだけ compose() の代わりに受信フレームをラッチする。
+class LedController {
+public:
+  // 解析済みコマンドを状態に反映する（CMD_STATS_REQUEST は呼び出し側で扱う）
+  void apply(const Command& cmd, uint32_t now);
+
+  // 現在のモードの色を計算する（フレームごとに1回）
+  void update(uint32_t now);
+
+  // このフレームで全LEDに塗る色（MODE_STREAM では使わない）
+  CRGB frameColor() const;
+
+  // strip を描く（MODE_STREAM では使わない）
+  // 行・列のエフェクトは Map（xy_map.h）で座標から画素を引き、それ以外は frameColor() で塗る
+  template <typename Map, typename Strip>
+  void compose(Strip& strip) const;
+
+  ColorMode mode() const { return colorMode_; }
+  CRGB color() const { return currentColor_; }
+  uint8_t hue() const { return hue_; }
+  bool transitioning() const { return isTransitioning_; }
+
+private:
+  // デバイス内で再生中のアニメーション（エフェクト・タイムライン）を止める
+  void stopAnimations();
+
+  uint32_t frameTime_ = 0; // 最後に update() した時刻
+  uint8_t hue_ = 0; // 色相の変化用
+  uint32_t lastHueStep_ = 0;
+  bool autoHueChange_ = true; // 自動色相変化モード
+  CRGB currentColor_ = CRGB::White; // 初期色は白
+  ColorMode colorMode_ = MODE_AUTO; // 初期モードは自動色相変化
+
+  // 色遷移関連
+  bool isTransitioning_ = false; // 色遷移中かどうか
+  CRGB startColor_;              // 遷移開始色
+  CRGB targetColor_;             // 遷移目標色
+  uint32_t transitionStartTime_ = 0; // 遷移開始時刻
+  uint32_t transitionDuration_ = DEFAULT_TRANSITION_TIME; // 遷移時間
+  uint8_t transitionEasing_ = EASE_LINEAR; // 遷移のイージング
+
+  // デバイス内で再生するエフェクト
+  EffectEngine effect_;
+  // アップロードされたキーフレームタイムライン
+  Timeline timeline_;
+};
+
+template <typename Map, typename Strip>
+void LedController::compose(Strip& strip) const {
+  static_assert(Map::WIDTH * Map::HEIGHT == Strip::SIZE, "XyMap must cover the whole strip");
+
+  EffectType type = effect_.type();
+  if (colorMode_ != MODE_EFFECT ||
+      (type != EFFECT_SWEEP && type != EFFECT_CHASE && type != EFFECT_CHASE_REVERSE)) {
+    strip.fill(frameColor());
+    return;
+  }
+
+  if (type == EFFECT_SWEEP) {
+    // 上の行から順に点灯
+    for (size_t y = 0; y < Map::HEIGHT; y++) {
+      CRGB color = effect_.renderLine(frameTime_, y, Map::HEIGHT);
+      for (size_t x = 0; x < Map::WIDTH; x++) {
+        strip[Map::index(x, y)] = color;
+      }
+    }
+  } else {
+    // 列ごとに点灯（EFFECT_CHASE は左から、EFFECT_CHASE_REVERSE は右から）
+    for (size_t x = 0; x < Map::WIDTH; x++) {
+      size_t line = (type == EFFECT_CHASE) ? x : Map::WIDTH - 1 - x;
+      CRGB color = effect_.renderLine(frameTime_, line, Map::WIDTH);
+      for (size_t y = 0; y < Map::HEIGHT; y++) {
+        strip[Map::index(x, y)] = color;
+      }
+    }
+  }
+}
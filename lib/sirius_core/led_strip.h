@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <FastLED.h>
+
+// LEDテープの並び（コンパイル時に決まる）
+//
+// 同じ長さのセグメントが Segments 本つながった1本のテープとして扱う。
+// 例: 耳は12個ずつのセグメントが4本で、StripLayout<4, 12>。
+template <size_t Segments, size_t SegmentLength>
+struct StripLayout {
+  static_assert(Segments > 0 && SegmentLength > 0, "StripLayout must not be empty");
+
+  static constexpr size_t SEGMENTS = Segments;
+  static constexpr size_t SEGMENT_LENGTH = SegmentLength;
+  static constexpr size_t PIXELS = Segments * SegmentLength;
+
+  // セグメント segment の index 番目の画素番号
+  static constexpr size_t pixel(size_t segment, size_t index) {
+    return segment * SegmentLength + index;
+  }
+};
+
+// LEDの画素バッファ
+//
+// 大きさは Layout から決まるので、塗りつぶしのループ回数も定数になる。
+template <typename Layout>
+class LedStrip {
+public:
+  using layout = Layout;
+  static constexpr size_t SIZE = Layout::PIXELS;
+
+  void fill(const CRGB& color) {
+    for (size_t i = 0; i < SIZE; i++) {
+      leds_[i] = color;
+    }
+  }
+
+  CRGB& operator[](size_t i) { return leds_[i]; }
+  const CRGB& operator[](size_t i) const { return leds_[i]; }
+
+  CRGB* pixels() { return leds_; }
+  const CRGB* pixels() const { return leds_; }
+  static constexpr size_t size() { return SIZE; }
+
+private:
+  CRGB leds_[SIZE];
+};
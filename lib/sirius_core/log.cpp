@@ -0,0 +1,90 @@
+#include "log.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+
+static_assert((LOG_QUEUE_SIZE & (LOG_QUEUE_SIZE - 1)) == 0, "LOG_QUEUE_SIZE must be a power of two");
+
+namespace {
+
+struct LogRecord {
+  const char* fmt;
+  int32_t args[LOG_MAX_ARGS];
+  uint8_t level;
+};
+
+// 複数プロデューサ・単一コンシューマの有界キュー
+// 各スロットのシーケンス番号で書き込み完了を判定する
+struct LogSlot {
+  std::atomic<uint32_t> seq;
+  LogRecord record;
+};
+
+struct LogQueue {
+  LogQueue() {
+    for (uint32_t i = 0; i < LOG_QUEUE_SIZE; i++) {
+      slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  LogSlot slots[LOG_QUEUE_SIZE];
+  std::atomic<uint32_t> enqueuePos{0};
+  uint32_t dequeuePos = 0; // コンシューマのみ
+  std::atomic<uint32_t> dropped{0};
+};
+
+LogQueue logQueue;
+
+} // namespace
+
+bool logPush(uint8_t level, const char* fmt, const int32_t* args) {
+  uint32_t pos = logQueue.enqueuePos.load(std::memory_order_relaxed);
+  LogSlot* slot;
+  for (;;) {
+    slot = &logQueue.slots[pos & (LOG_QUEUE_SIZE - 1)];
+    uint32_t seq = slot->seq.load(std::memory_order_acquire);
+    int32_t diff = (int32_t)(seq - pos);
+    if (diff == 0) {
+      // このスロットを確保
+      if (logQueue.enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // 満杯
+      logQueue.dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      pos = logQueue.enqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->record.fmt = fmt;
+  slot->record.level = level;
+  memcpy(slot->record.args, args, sizeof(slot->record.args));
+  slot->seq.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+bool logPop(char* line, size_t size, uint8_t& level) {
+  uint32_t pos = logQueue.dequeuePos;
+  LogSlot& slot = logQueue.slots[pos & (LOG_QUEUE_SIZE - 1)];
+  uint32_t seq = slot.seq.load(std::memory_order_acquire);
+  if ((int32_t)(seq - (pos + 1)) < 0) {
+    return false;
+  }
+
+  LogRecord record = slot.record;
+  slot.seq.store(pos + LOG_QUEUE_SIZE, std::memory_order_release);
+  logQueue.dequeuePos = pos + 1;
+
+  // 余分な引数は書式文字列で使われなければ無視される
+  const int32_t* a = record.args;
+  snprintf(line, size, record.fmt, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+  level = record.level;
+  return true;
+}
+
+uint32_t logDroppedCount() {
+  return logQueue.dropped.load(std::memory_order_relaxed);
+}
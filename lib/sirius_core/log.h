@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 遅延ログ
+//
+// LOG_xxx() は書式文字列のポインタと整数引数をリングバッファに積むだけで、
+// 文字列の整形とシリアル出力は loop() の空き時間に logPop() で行う。
+// コマンド処理やBLEコールバックがUARTの送信待ちでブロックしない。
+//
+// 出力レベルはビルド時に SIRIUS_LOG_LEVEL で決める。
+// レベル外のマクロは引数ごと消えるので実行時コストはゼロ。
+//
+// 制約: 引数は整数のみ（最大 LOG_MAX_ARGS 個）、書式文字列は文字列リテラルであること。
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef SIRIUS_LOG_LEVEL
+#define SIRIUS_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// 1レコードあたりの引数の最大数
+#define LOG_MAX_ARGS 8
+// リングバッファのレコード数（2のべき乗）
+#define LOG_QUEUE_SIZE 32
+// 整形後の1行の最大長
+#define LOG_LINE_MAX 160
+
+// ログを1件積む（満杯なら破棄して false）。どのタスクからでも呼べる
+bool logPush(uint8_t level, const char* fmt, const int32_t* args);
+
+// ログを1件取り出して line に整形する。空なら false（loop()からのみ呼ぶ）
+bool logPop(char* line, size_t size, uint8_t& level);
+
+// 満杯で破棄したログの累計数
+uint32_t logDroppedCount();
+
+template <typename... Args>
+inline void logWrite(uint8_t level, const char* fmt, Args... args) {
+  static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+  const int32_t values[LOG_MAX_ARGS] = { static_cast<int32_t>(args)... };
+  logPush(level, fmt, values);
+}
+
+#if SIRIUS_LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) logWrite(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+#if SIRIUS_LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) logWrite(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#if SIRIUS_LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) logWrite(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if SIRIUS_LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logWrite(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
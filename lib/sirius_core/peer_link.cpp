@@ -0,0 +1,135 @@
+#include "peer_link.h"
+
+#include <string.h>
+
+namespace {
+
+void putU32(uint8_t* p, uint32_t value) {
+  for (size_t i = 0; i < 4; i++) {
+    p[i] = (uint8_t)(value >> (8 * i));
+  }
+}
+
+uint32_t readU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// 統計・時刻同期はプライマリだけが応答する
+bool isPrimaryOnly(CommandType type) {
+  return type == CMD_STATS_REQUEST || type == CMD_TIME_PING || type == CMD_TIME_SET;
+}
+
+void putHeader(uint8_t* out, uint8_t group, PeerMessage type) {
+  out[0] = PEER_MAGIC;
+  out[1] = group;
+  out[2] = type;
+}
+
+} // namespace
+
+bool isRelayScheduled(CommandType type) {
+  return isSchedulable(type) && type != CMD_TIMELINE_CLEAR && type != CMD_TIMELINE_KEY;
+}
+
+size_t encodePeerClock(uint8_t* out, uint8_t group, uint32_t syncTime) {
+  putHeader(out, group, PEER_MSG_CLOCK);
+  putU32(out + PEER_HEADER, syncTime);
+  return PEER_HEADER + 4;
+}
+
+size_t encodePeerWrite(uint8_t* out, uint8_t group, const uint8_t* write, size_t len,
+                       bool hasStartAt, uint32_t startAt) {
+  if (len == 0 || len > PEER_PACKET_MAX - PEER_WRITE_HEADER) {
+    return 0;
+  }
+  putHeader(out, group, PEER_MSG_WRITE);
+  out[PEER_HEADER] = hasStartAt ? PEER_WRITE_FLAG_START_AT : 0;
+  putU32(out + PEER_HEADER + 1, startAt);
+  memcpy(out + PEER_WRITE_HEADER, write, len);
+  return PEER_WRITE_HEADER + len;
+}
+
+bool parsePeerPacket(const uint8_t* data, size_t len, uint8_t group, PeerPacket& out) {
+  if (len < PEER_HEADER || data[0] != PEER_MAGIC || data[1] != group) {
+    return false;
+  }
+  switch (data[2]) {
+    case PEER_MSG_CLOCK:
+      if (len != PEER_HEADER + 4) {
+        return false;
+      }
+      out.type = PEER_MSG_CLOCK;
+      out.time = readU32(data + PEER_HEADER);
+      out.hasStartAt = false;
+      out.write = nullptr;
+      out.writeLen = 0;
+      return true;
+
+    case PEER_MSG_WRITE:
+      if (len <= PEER_WRITE_HEADER) {
+        return false;
+      }
+      out.type = PEER_MSG_WRITE;
+      out.hasStartAt = (data[PEER_HEADER] & PEER_WRITE_FLAG_START_AT) != 0;
+      out.time = readU32(data + PEER_HEADER + 1);
+      out.write = data + PEER_WRITE_HEADER;
+      out.writeLen = len - PEER_WRITE_HEADER;
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+bool stampRelayBatch(CommandBatch& batch, uint32_t startAt) {
+  // OP_AT で届いたものはホストの指定した開始時刻のまま
+  bool stamped = false;
+  for (size_t i = 0; i < batch.count; i++) {
+    Command& cmd = batch.commands[i];
+    if (!cmd.hasStartAt && isRelayScheduled(cmd.type)) {
+      cmd.hasStartAt = true;
+      cmd.startAt = startAt;
+      stamped = true;
+    }
+  }
+  return stamped;
+}
+
+bool relayBatch(PeerLink& link, uint8_t group, const uint8_t* data, const CommandBatch& batch,
+                bool stamped, uint32_t startAt) {
+  // 転送するコマンドを元の形式（バイナリは先頭に PROTOCOL_MAGIC、ASCIIは改行区切り）で詰め直す
+  const size_t capacity = PEER_PACKET_MAX - PEER_WRITE_HEADER;
+  uint8_t write[capacity];
+  uint8_t packet[PEER_PACKET_MAX];
+  size_t len = 0;
+  bool sent = true;
+  for (size_t i = 0; i < batch.count; i++) {
+    if (isPrimaryOnly(batch.commands[i].type)) {
+      continue;
+    }
+    size_t spanLen = batch.spanLen[i];
+    size_t needed = spanLen + (len == 0 ? (batch.binary ? 1 : 0) : (batch.binary ? 0 : 1));
+    if (len > 0 && len + needed > capacity) {
+      size_t packetLen = encodePeerWrite(packet, group, write, len, stamped, startAt);
+      sent = link.send(packet, packetLen) && sent;
+      len = 0;
+      needed = spanLen + (batch.binary ? 1 : 0);
+    }
+    if (needed > capacity) {
+      sent = false; // 1コマンドだけでも収まらない
+      continue;
+    }
+    if (len == 0 && batch.binary) {
+      write[len++] = PROTOCOL_MAGIC;
+    } else if (len > 0 && !batch.binary) {
+      write[len++] = '\n';
+    }
+    memcpy(&write[len], data + batch.spanStart[i], spanLen);
+    len += spanLen;
+  }
+  if (len > 0) {
+    size_t packetLen = encodePeerWrite(packet, group, write, len, stamped, startAt);
+    sent = link.send(packet, packetLen) && sent;
+  }
+  return sent;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol.h"
+
+// 耳どうしの中継（ピアリンク）
+//
+// ホストはプライマリの耳にだけ接続し、プライマリは受け取った書き込みを
+// ピアリンクでセカンダリへ転送する。状態を変えるコマンドには共有時計で
+// 少し先の開始時刻を付け、自分も同じ時刻に始めるので、左右が同じミリ秒で動く。
+// プライマリは共有時計も定期的に送り、セカンダリはそれに合わせる。
+//
+// 実機は ESP-NOW（src/espnow_peer_link.h）、ホストはプロセス内のループバックで動かす。
+//
+// パケットの形式（リトルエンディアン）:
+//   PEER_MAGIC,GROUP,PEER_MSG_CLOCK,TIME(u32)             プライマリの共有時計
+//   PEER_MAGIC,GROUP,PEER_MSG_WRITE,FLAGS,START_AT(u32),書き込み  転送した書き込み
+// GROUP は組になる耳の番号で、近くにある別の組のパケットを無視するのに使う。
+
+// 1パケットの最大長（ESP-NOW の上限）
+#define PEER_PACKET_MAX 250
+#define PEER_MAGIC 0x5A
+#define PEER_HEADER 3
+#define PEER_WRITE_HEADER (PEER_HEADER + 5)
+#define PEER_WRITE_FLAG_START_AT 0x01
+
+// 転送するコマンドに付ける開始時刻の余裕（ミリ秒）。リンクの遅延と再送より長くする
+#define PEER_RELAY_LEAD_MS 20
+// プライマリが共有時計を送る間隔（ミリ秒）
+#define PEER_CLOCK_INTERVAL_MS 1000
+// 共有時計のパケットが届くまでの遅延の見込み（ミリ秒）
+#define PEER_LINK_LATENCY_MS 1
+
+enum PeerRole : uint8_t {
+  PEER_ROLE_NONE,      // 中継しない
+  PEER_ROLE_PRIMARY,   // ホストから受け取って転送する
+  PEER_ROLE_SECONDARY, // プライマリから受け取る
+};
+
+enum PeerMessage : uint8_t {
+  PEER_MSG_CLOCK = 1,
+  PEER_MSG_WRITE = 2,
+};
+
+// パケットを運ぶ下位の通信路
+class PeerLink {
+public:
+  virtual ~PeerLink() = default;
+
+  // 相手へ1パケット送る（届いたかは分からない）
+  virtual bool send(const uint8_t* data, size_t len) = 0;
+  // 受信したパケットを1つ取り出す（loop() から呼ぶ）。receivedMs は受信した時刻（millis()）
+  virtual bool receive(uint8_t* data, size_t& len, uint32_t& receivedMs) = 0;
+};
+
+// 解析したパケット（write は受信データ内を指す）
+struct PeerPacket {
+  PeerMessage type;
+  uint32_t time;   // PEER_MSG_CLOCK: 共有時計、PEER_MSG_WRITE: 開始時刻
+  bool hasStartAt;
+  const uint8_t* write;
+  size_t writeLen;
+};
+
+size_t encodePeerClock(uint8_t* out, uint8_t group, uint32_t syncTime);
+// 書き込みが PEER_PACKET_MAX に収まらなければ 0
+size_t encodePeerWrite(uint8_t* out, uint8_t group, const uint8_t* write, size_t len,
+                       bool hasStartAt, uint32_t startAt);
+// 別の組・不正なパケットは false
+bool parsePeerPacket(const uint8_t* data, size_t len, uint8_t group, PeerPacket& out);
+
+// 転送するときに開始時刻を揃えるコマンドか（画を変える状態コマンドだけ）
+// タイムラインの消去・キーフレームの追加は画を変えないので、両方の耳で受信したときに反映する
+bool isRelayScheduled(CommandType type);
+
+// プライマリ: 転送する書き込み（解析済みの batch）の状態コマンドに開始時刻を付ける
+// 開始時刻のない状態コマンド（isRelayScheduled()）に startAt を設定し、1つでも付けたら true。
+// 自分のキューに積む前に呼び、両方の耳が同じ開始時刻で始めるようにする。
+bool stampRelayBatch(CommandBatch& batch, uint32_t startAt);
+
+// プライマリ: 自分のキューに積めた書き込みをセカンダリへ転送する
+// stamped なら（stampRelayBatch() の結果）開始時刻 startAt を付けて送る。
+// 統計・時刻同期はプライマリだけのコマンドなので転送しない。
+// 1パケットに収まらないバッチはコマンドの境目で分けて送る（状態コマンドの開始時刻はどれも同じ）。
+bool relayBatch(PeerLink& link, uint8_t group, const uint8_t* data, const CommandBatch& batch,
+                bool stamped, uint32_t startAt);
@@ -0,0 +1,472 @@
+#include "protocol.h"
+
+#include "easing.h"
+#include "effects.h"
+
+#include <string.h>
+
+// ASCIIコマンドの数値フィールドの最大数（E:）
+#define ASCII_MAX_FIELDS 7
+
+// 可変長ペイロード（先頭1バイトが長さ）を示す値
+#define PAYLOAD_LEN_PREFIXED 0xFF
+
+namespace {
+
+uint16_t readU16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+uint32_t readU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool decodeColor(const uint8_t* p, size_t /*len*/, Command& out) {
+  out.type = CMD_COLOR;
+  out.r = p[0];
+  out.g = p[1];
+  out.b = p[2];
+  return true;
+}
+
+bool decodeHue(const uint8_t* p, size_t /*len*/, Command& out) {
+  out.type = CMD_HUE;
+  out.hue = p[0];
+  return true;
+}
+
+bool decodeMode(const uint8_t* p, size_t /*len*/, Command& out) {
+  // ASCII の M: と同じく 0/1 以外は受け付けない
+  if (p[0] > 1) {
+    return false;
+  }
+  out.type = CMD_MODE;
+  out.mode = p[0];
+  return true;
+}
+
+bool decodeTransition(const uint8_t* p, size_t /*len*/, Command& out) {
+  out.type = CMD_TRANSITION;
+  out.r = p[0];
+  out.g = p[1];
+  out.b = p[2];
+  out.hasDuration = true;
+  out.duration = readU16(p + 3);
+  return true;
+}
+
+bool decodeTransitionEased(const uint8_t* p, size_t len, Command& out) {
+  if (p[5] >= EASING_COUNT) {
+    return false;
+  }
+  decodeTransition(p, len, out);
+  out.easing = p[5];
+  return true;
+}
+
+bool decodeFrame(const uint8_t* p, size_t len, Command& out) {
+  // START の後ろに3バイト単位のRGBが続く
+  if (len < 1 || (len - 1) % 3 != 0) {
+    return false;
+  }
+  out.type = CMD_FRAME;
+  out.start = p[0];
+  out.count = (uint16_t)((len - 1) / 3);
+  out.pixels = p + 1;
+  return true;
+}
+
+bool decodeFrameDelta(const uint8_t* p, size_t len, Command& out) {
+  // スパンの検証は適用時に画素数と合わせて行う
+  out.type = CMD_FRAME_DELTA;
+  out.count = (uint16_t)len;
+  out.pixels = p;
+  return true;
+}
+
+bool decodeEffect(const uint8_t* p, size_t /*len*/, Command& out) {
+  if (p[0] >= EFFECT_TYPE_COUNT) {
+    return false;
+  }
+  out.type = CMD_EFFECT;
+  out.effect = p[0];
+  out.r = p[1];
+  out.g = p[2];
+  out.b = p[3];
+  out.period = readU16(p + 4);
+  out.cycles = p[6];
+  out.fade = readU16(p + 7);
+  return true;
+}
+
+bool decodeTimelineClear(const uint8_t* /*p*/, size_t /*len*/, Command& out) {
+  out.type = CMD_TIMELINE_CLEAR;
+  return true;
+}
+
+bool decodeTimelineKey(const uint8_t* p, size_t /*len*/, Command& out) {
+  if (p[7] >= EASING_COUNT) {
+    return false;
+  }
+  out.type = CMD_TIMELINE_KEY;
+  out.time = readU32(p);
+  out.r = p[4];
+  out.g = p[5];
+  out.b = p[6];
+  out.easing = p[7];
+  return true;
+}
+
+bool decodeTimelinePlay(const uint8_t* p, size_t /*len*/, Command& out) {
+  out.type = CMD_TIMELINE_PLAY;
+  out.flags = p[0];
+  return true;
+}
+
+bool decodeStatsRequest(const uint8_t* p, size_t /*len*/, Command& out) {
+  out.type = CMD_STATS_REQUEST;
+  out.report = p[0];
+  out.flags = p[1];
+  return true;
+}
+
+bool decodeTimePing(const uint8_t* p, size_t /*len*/, Command& out) {
+  out.type = CMD_TIME_PING;
+  out.time = readU32(p);
+  return true;
+}
+
+bool decodeTimeSet(const uint8_t* p, size_t /*len*/, Command& out) {
+  out.type = CMD_TIME_SET;
+  out.time = readU32(p);
+  return true;
+}
+
+bool decodeAt(const uint8_t* p, size_t len, Command& out) {
+  // TIME の後ろに1コマンドが過不足なく入っている（OP_AT の入れ子は受け付けない）
+  if (len < 5 || p[4] == OP_AT) {
+    return false;
+  }
+  size_t consumed;
+  if (parseBinaryCommand(p + 4, len - 4, out, consumed) != PARSE_OK || consumed != len - 4 ||
+      !isSchedulable(out.type)) {
+    return false;
+  }
+  out.hasStartAt = true;
+  out.startAt = readU32(p);
+  return true;
+}
+
+// オペコードのディスパッチテーブル（オペコード値で直接引く）
+struct OpcodeEntry {
+  uint8_t payloadLen; // 固定長、または PAYLOAD_LEN_PREFIXED
+  bool (*decode)(const uint8_t* payload, size_t len, Command& out);
+};
+
+const OpcodeEntry kOpcodeTable[OPCODE_COUNT] = {
+  /* 0x00                */ { 0, nullptr },
+  /* OP_COLOR            */ { 3, decodeColor },
+  /* OP_HUE              */ { 1, decodeHue },
+  /* OP_MODE             */ { 1, decodeMode },
+  /* OP_TRANSITION       */ { 5, decodeTransition },
+  /* OP_FRAME            */ { PAYLOAD_LEN_PREFIXED, decodeFrame },
+  /* OP_FRAME_DELTA      */ { PAYLOAD_LEN_PREFIXED, decodeFrameDelta },
+  /* OP_EFFECT           */ { 9, decodeEffect },
+  /* OP_TIMELINE_CLEAR   */ { 0, decodeTimelineClear },
+  /* OP_TIMELINE_KEY     */ { 8, decodeTimelineKey },
+  /* OP_TIMELINE_PLAY    */ { 1, decodeTimelinePlay },
+  /* OP_TRANSITION_EASED */ { 6, decodeTransitionEased },
+  /* OP_STATS_REQUEST    */ { 2, decodeStatsRequest },
+  /* OP_TIME_PING        */ { 4, decodeTimePing },
+  /* OP_TIME_SET         */ { 4, decodeTimeSet },
+  /* OP_AT               */ { PAYLOAD_LEN_PREFIXED, decodeAt },
+};
+
+bool isAsciiSpace(uint8_t c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// "X:" の後ろのカンマ区切りの10進数を読む（受信データを直接読み、コピーもNUL終端もしない）
+// 数値の前後の空白と末尾の改行は読み飛ばす。空のフィールド・数字以外の文字・
+// ASCII_MAX_FIELDS を超えるフィールドは PARSE_INVALID、uint32_t に収まらない値は PARSE_OUT_OF_RANGE
+ParseResult readDecimalFields(const uint8_t* p, size_t len, uint32_t* values, size_t& count) {
+  size_t i = 0;
+  count = 0;
+  for (;;) {
+    while (i < len && isAsciiSpace(p[i])) {
+      i++;
+    }
+    size_t digits = 0;
+    uint32_t value = 0;
+    while (i < len && p[i] >= '0' && p[i] <= '9') {
+      uint32_t digit = p[i] - '0';
+      if (value > (UINT32_MAX - digit) / 10) {
+        return PARSE_OUT_OF_RANGE;
+      }
+      value = value * 10 + digit;
+      digits++;
+      i++;
+    }
+    if (digits == 0 || count >= ASCII_MAX_FIELDS) {
+      return PARSE_INVALID;
+    }
+    values[count++] = value;
+    while (i < len && isAsciiSpace(p[i])) {
+      i++;
+    }
+    if (i == len) {
+      return PARSE_OK;
+    }
+    if (p[i] != ',') {
+      return PARSE_INVALID;
+    }
+    i++;
+  }
+}
+
+bool allAtMost(const uint32_t* values, size_t count, uint32_t max) {
+  for (size_t i = 0; i < count; i++) {
+    if (values[i] > max) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+ParseResult parseBinaryCommand(const uint8_t* data, size_t len, Command& out, size_t& consumed) {
+  consumed = 0;
+  if (len == 0) {
+    return PARSE_EMPTY;
+  }
+
+  uint8_t opcode = data[0];
+  if (opcode >= OPCODE_COUNT || kOpcodeTable[opcode].decode == nullptr) {
+    return PARSE_UNKNOWN;
+  }
+
+  const OpcodeEntry& entry = kOpcodeTable[opcode];
+  size_t header = 1;
+  size_t payloadLen = entry.payloadLen;
+  if (payloadLen == PAYLOAD_LEN_PREFIXED) {
+    if (len < 2) {
+      return PARSE_TRUNCATED;
+    }
+    payloadLen = data[1];
+    header = 2;
+  }
+  if (len < header + payloadLen) {
+    return PARSE_TRUNCATED;
+  }
+
+  memset(&out, 0, sizeof(out));
+  if (!entry.decode(data + header, payloadLen, out)) {
+    return PARSE_INVALID;
+  }
+  consumed = header + payloadLen;
+  return PARSE_OK;
+}
+
+bool isSchedulable(CommandType type) {
+  switch (type) {
+    case CMD_COLOR:
+    case CMD_HUE:
+    case CMD_MODE:
+    case CMD_TRANSITION:
+    case CMD_EFFECT:
+    case CMD_TIMELINE_CLEAR:
+    case CMD_TIMELINE_KEY:
+    case CMD_TIMELINE_PLAY:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void encodeTimeReply(uint8_t* out, uint32_t hostTime, uint32_t rxTime, uint32_t txTime) {
+  const uint32_t values[] = { hostTime, rxTime, txTime };
+  out[0] = PROTOCOL_MAGIC;
+  out[1] = OP_TIME_PING;
+  for (size_t i = 0; i < 3; i++) {
+    for (size_t b = 0; b < 4; b++) {
+      out[2 + i * 4 + b] = (uint8_t)(values[i] >> (8 * b));
+    }
+  }
+}
+
+ParseResult parseAsciiCommand(const uint8_t* data, size_t len, Command& out) {
+  if (len == 0) {
+    return PARSE_EMPTY;
+  }
+  if (len < 2 || data[1] != ':') {
+    return PARSE_UNKNOWN;
+  }
+
+  uint32_t v[ASCII_MAX_FIELDS];
+  size_t count = 0;
+  ParseResult result = readDecimalFields(data + 2, len - 2, v, count);
+  if (result != PARSE_OK) {
+    return result;
+  }
+
+  memset(&out, 0, sizeof(out));
+  switch (data[0]) {
+    case 'C':
+      // RGB値で色を設定（例: C:255,0,0）
+      if (count != 3) {
+        return PARSE_INVALID;
+      }
+      if (!allAtMost(v, 3, 255)) {
+        return PARSE_OUT_OF_RANGE;
+      }
+      out.type = CMD_COLOR;
+      out.r = v[0];
+      out.g = v[1];
+      out.b = v[2];
+      return PARSE_OK;
+
+    case 'H':
+      // 色相値を設定（例: H:128）
+      if (count != 1) {
+        return PARSE_INVALID;
+      }
+      if (v[0] > 255) {
+        return PARSE_OUT_OF_RANGE;
+      }
+      out.type = CMD_HUE;
+      out.hue = v[0];
+      return PARSE_OK;
+
+    case 'M':
+      // モード切替（例: M:1で自動色相変化、M:0で固定色）
+      if (count != 1) {
+        return PARSE_INVALID;
+      }
+      if (v[0] > 1) {
+        return PARSE_OUT_OF_RANGE;
+      }
+      out.type = CMD_MODE;
+      out.mode = v[0];
+      return PARSE_OK;
+
+    case 'T':
+      // 色遷移コマンド（例: T:255,0,0 / T:255,0,0,2000 / T:255,0,0,2000,4）
+      if (count < 3 || count > 5) {
+        return PARSE_INVALID;
+      }
+      if (!allAtMost(v, 3, 255) || (count == 5 && v[4] >= EASING_COUNT)) {
+        return PARSE_OUT_OF_RANGE;
+      }
+      out.type = CMD_TRANSITION;
+      out.r = v[0];
+      out.g = v[1];
+      out.b = v[2];
+      out.hasDuration = (count >= 4);
+      out.duration = out.hasDuration ? v[3] : 0;
+      out.easing = (count == 5) ? (uint8_t)v[4] : (uint8_t)EASE_LINEAR;
+      return PARSE_OK;
+
+    case 'E':
+      // エフェクト開始（例: E:0,255,191,0,500,6,300）
+      if (count != 7) {
+        return PARSE_INVALID;
+      }
+      if (v[0] >= EFFECT_TYPE_COUNT || !allAtMost(v + 1, 3, 255) ||
+          v[4] > 0xFFFF || v[5] > 255 || v[6] > 0xFFFF) {
+        return PARSE_OUT_OF_RANGE;
+      }
+      out.type = CMD_EFFECT;
+      out.effect = v[0];
+      out.r = v[1];
+      out.g = v[2];
+      out.b = v[3];
+      out.period = v[4];
+      out.cycles = v[5];
+      out.fade = v[6];
+      return PARSE_OK;
+
+    default:
+      return PARSE_UNKNOWN;
+  }
+}
+
+namespace {
+
+// 解析した out.commands[out.count] の位置を記録して確定する
+void addToBatch(CommandBatch& out, size_t start, size_t len) {
+  out.spanStart[out.count] = (uint16_t)start;
+  out.spanLen[out.count] = (uint16_t)len;
+  out.count++;
+}
+
+ParseResult parseBinaryBatch(const uint8_t* data, size_t len, CommandBatch& out) {
+  size_t offset = 1;
+  while (offset < len) {
+    if (out.count >= COMMAND_BATCH_MAX) {
+      return PARSE_INVALID;
+    }
+    size_t consumed;
+    ParseResult result = parseBinaryCommand(data + offset, len - offset, out.commands[out.count], consumed);
+    if (result != PARSE_OK) {
+      return result;
+    }
+    addToBatch(out, offset, consumed);
+    offset += consumed;
+  }
+  return out.count > 0 ? PARSE_OK : PARSE_EMPTY;
+}
+
+ParseResult parseAsciiBatch(const uint8_t* data, size_t len, CommandBatch& out) {
+  size_t start = 0;
+  while (start < len) {
+    const uint8_t* newline = (const uint8_t*)memchr(data + start, '\n', len - start);
+    size_t end = newline != nullptr ? (size_t)(newline - data) : len;
+    size_t first = start;
+    while (first < end && isAsciiSpace(data[first])) {
+      first++;
+    }
+    if (first < end) {
+      if (out.count >= COMMAND_BATCH_MAX) {
+        return PARSE_INVALID;
+      }
+      ParseResult result = parseAsciiCommand(data + first, end - first, out.commands[out.count]);
+      if (result != PARSE_OK) {
+        return result;
+      }
+      addToBatch(out, first, end - first);
+    }
+    start = end + 1;
+  }
+  return out.count > 0 ? PARSE_OK : PARSE_EMPTY;
+}
+
+} // namespace
+
+ParseResult parseCommandBatch(const uint8_t* data, size_t len, CommandBatch& out) {
+  out.count = 0;
+  out.binary = len > 0 && data[0] == PROTOCOL_MAGIC;
+  if (len == 0) {
+    return PARSE_EMPTY;
+  }
+  // span は uint16_t（BLEの書き込みは最大512バイト）
+  if (len > UINT16_MAX) {
+    return PARSE_INVALID;
+  }
+  ParseResult result = out.binary ? parseBinaryBatch(data, len, out) : parseAsciiBatch(data, len, out);
+  if (result != PARSE_OK) {
+    out.count = 0;
+  }
+  return result;
+}
+
+ParseResult parseCommand(const uint8_t* data, size_t len, Command& out) {
+  if (len == 0) {
+    return PARSE_EMPTY;
+  }
+  if (data[0] == PROTOCOL_MAGIC) {
+    size_t consumed;
+    return parseBinaryCommand(data + 1, len - 1, out, consumed);
+  }
+  return parseAsciiCommand(data, len, out);
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// コマンドプロトコル
+//
+// 1回の書き込みは以下のどちらかの形式で送られる
+//   ASCII形式  : "C:255,0,0" / "H:128" / "M:1" / "T:255,0,0,2000"（従来互換）
+//                "T:R,G,B,TIME,EASING"（EASINGは省略可、easing.h）
+//                "E:TYPE,R,G,B,PERIOD,CYCLES,FADE"
+//   バイナリ形式: 先頭1バイトが PROTOCOL_MAGIC、続いて [オペコード][ペイロード]
+//   OP_FRAME などバイナリ形式にしかないコマンドもある
+//
+// バイナリのペイロードは固定長・リトルエンディアン。
+// 可変長のオペコードはペイロードの前に1バイトの長さを置く。
+//
+// 1回の書き込みに複数のコマンドをまとめて送れる（バッチ、parseCommandBatch()）
+//   ASCII形式  : 改行区切り "C:255,0,0\nE:0,255,191,0,500,6,300"
+//   バイナリ形式: PROTOCOL_MAGIC の後ろに [オペコード][ペイロード] を続けて並べる
+// バッチのコマンドは全部同じフレームで反映される。
+
+// バイナリ形式を示す先頭バイト（ASCIIコマンドと衝突しない値）
+#define PROTOCOL_MAGIC 0xA5
+
+// バイナリオペコード
+enum Opcode : uint8_t {
+  OP_COLOR            = 0x01, // R,G,B
+  OP_HUE              = 0x02, // HUE
+  OP_MODE             = 0x03, // MODE（1:自動色相変化、0:固定色）
+  OP_TRANSITION       = 0x04, // R,G,B,TIME(u16 ms)
+  OP_FRAME            = 0x05, // [LEN] START,(R,G,B)*n  ピクセルフレーム
+  OP_FRAME_DELTA      = 0x06, // [LEN] スパン列  差分ピクセルフレーム（frame_codec.h）
+  OP_EFFECT           = 0x07, // TYPE,R,G,B,PERIOD(u16 ms),CYCLES,FADE(u16 ms)  エフェクト開始
+  OP_TIMELINE_CLEAR   = 0x08, // (なし)  キーフレームを全削除
+  OP_TIMELINE_KEY     = 0x09, // TIME(u32 ms),R,G,B,EASING  キーフレーム追加（timeline.h）
+  OP_TIMELINE_PLAY    = 0x0A, // FLAGS(bit0:ループ)  タイムライン再生開始
+  OP_TRANSITION_EASED = 0x0B, // R,G,B,TIME(u16 ms),EASING  イージング付き色遷移
+  OP_STATS_REQUEST    = 0x0C, // REPORT,FLAGS(bit0:リセット,bit1:シリアル出力)  統計レポート要求
+  OP_TIME_PING        = 0x0D, // HOST_TIME(u32 ms)  時刻同期の問い合わせ（応答は通知、TIME_REPLY_LENGTH）
+  OP_TIME_SET         = 0x0E, // OFFSET(u32 ms)  共有時計 = millis() + OFFSET
+  OP_AT               = 0x0F, // [LEN] TIME(u32 ms),オペコード,ペイロード  共有時計の TIME に実行
+  OPCODE_COUNT
+};
+
+// OP_TIMELINE_PLAY のフラグ
+#define TIMELINE_FLAG_LOOP 0x01
+
+// OP_STATS_REQUEST のレポート種別とフラグ
+#define STATS_REPORT_LATENCY 0 // コマンド到着から表示までの遅延
+#define STATS_REPORT_PROFILE 1 // loop() の区間別の所要時間
+#define STATS_REPORT_STREAM 2  // ストリームの受信数・抜け（stream.h）
+#define STATS_FLAG_RESET 0x01  // レポート作成後に集計をリセット
+#define STATS_FLAG_SERIAL 0x02 // シリアルにも出力する（STATS_REPORT_PROFILE）
+
+// OP_TIME_PING の応答（メインのキャラクタリスティックで通知する）
+//   PROTOCOL_MAGIC,OP_TIME_PING,HOST_TIME(u32),RX(u32),TX(u32)
+// RX/TX はデバイスが受信・応答した時刻（millis()）。ホストは送受信の時刻と合わせて
+// 往復の遅延を差し引いたオフセットを求め、OP_TIME_SET で共有時計を合わせる。
+#define TIME_REPLY_LENGTH 14
+
+// 解析済みコマンドの種類
+enum CommandType : uint8_t {
+  CMD_NONE,
+  CMD_COLOR,      // 固定色
+  CMD_HUE,        // 色相
+  CMD_MODE,       // モード切替
+  CMD_TRANSITION, // 色遷移
+  CMD_FRAME,      // ピクセルフレーム（次のshowでラッチ）
+  CMD_FRAME_DELTA, // 差分ピクセルフレーム
+  CMD_EFFECT,      // エフェクト開始（effects.h）
+  CMD_TIMELINE_CLEAR, // キーフレーム全削除
+  CMD_TIMELINE_KEY,   // キーフレーム追加
+  CMD_TIMELINE_PLAY,  // タイムライン再生開始
+  CMD_STATS_REQUEST,  // 統計レポート要求
+  CMD_TIME_PING,      // 時刻同期の問い合わせ
+  CMD_TIME_SET        // 共有時計のオフセット設定
+};
+
+// 解析結果
+enum ParseResult : uint8_t {
+  PARSE_OK,
+  PARSE_EMPTY,     // データなし
+  PARSE_UNKNOWN,   // 未知のコマンド・オペコード
+  PARSE_TRUNCATED, // ペイロードが足りない
+  PARSE_INVALID,   // 書式不正
+  PARSE_OUT_OF_RANGE, // 値が範囲外（色が255を超える、未知のイージングなど）
+  PARSE_BUSY          // 受け取れない（キューに空きがない）。書き込み全体を捨てた
+};
+
+// 解析済みコマンド（ASCII・バイナリ共通）
+struct Command {
+  CommandType type;
+  uint8_t r, g, b;
+  uint8_t hue;
+  uint8_t mode;
+  bool hasDuration;  // T:でTIMEが指定されたか
+  uint32_t duration; // 遷移時間（ミリ秒）
+  uint8_t easing;    // CMD_TRANSITION / CMD_TIMELINE_KEY の補間方法（Easing）
+
+  // CMD_EFFECT
+  uint8_t effect;  // EffectType
+  uint8_t cycles;  // 繰り返し回数（0で無限）
+  uint16_t period; // 点滅の間隔（ミリ秒）
+  uint16_t fade;   // フェード時間（ミリ秒）
+
+  // CMD_TIMELINE_KEY / CMD_TIMELINE_PLAY（色は r,g,b）
+  uint32_t time;   // キーフレームの時刻、CMD_TIME_PING のホスト時刻、CMD_TIME_SET のオフセット（ミリ秒）
+  uint8_t flags;   // TIMELINE_FLAG_* / STATS_FLAG_*
+
+  // CMD_STATS_REQUEST
+  uint8_t report;  // STATS_REPORT_*
+
+  // onWrite で受信した時刻（micros()）
+  uint32_t arrivalUs;
+  // 1回の書き込みの最後のコマンド（loop() は予約をバッチ単位で行う）
+  bool batchEnd;
+
+  // OP_AT で予約されたコマンド: 共有時計の startAt（ミリ秒）に実行する
+  bool hasStartAt;
+  uint32_t startAt;
+
+  // CMD_FRAME / CMD_FRAME_DELTA: 受信データ内を指す（onWrite 内でのみ有効）
+  uint16_t start;        // 先頭の画素番号（CMD_FRAME）
+  uint16_t count;        // 画素数（CMD_FRAME）、差分データのバイト数（CMD_FRAME_DELTA）
+  const uint8_t* pixels; // R,G,B の並び、または差分データ
+};
+
+// 1回の書き込みに入れられるコマンドの最大数
+#define COMMAND_BATCH_MAX 16
+
+// 1回の書き込みを解析したコマンドの並び
+// span は各コマンドの書き込み内の位置（バイナリは PROTOCOL_MAGIC を含まない、ASCIIは改行を含まない）
+struct CommandBatch {
+  Command commands[COMMAND_BATCH_MAX];
+  uint16_t spanStart[COMMAND_BATCH_MAX];
+  uint16_t spanLen[COMMAND_BATCH_MAX];
+  size_t count;
+  bool binary;
+};
+
+// 1回の書き込み全体を1コマンドとして解析する（先頭バイトで形式を判定）
+ParseResult parseCommand(const uint8_t* data, size_t len, Command& out);
+
+// 1回の書き込みを1つ以上のコマンドとして解析する
+// どれか1つでも不正なら全体を捨てる（一部だけ反映しない）。
+// 空行は読み飛ばし、COMMAND_BATCH_MAX を超えるものは PARSE_INVALID
+ParseResult parseCommandBatch(const uint8_t* data, size_t len, CommandBatch& out);
+
+// ASCII形式のコマンドを解析する
+ParseResult parseAsciiCommand(const uint8_t* data, size_t len, Command& out);
+
+// バイナリ形式のコマンドを1つ解析する（PROTOCOL_MAGICの後ろから）
+// consumed には読み進めたバイト数が入る
+ParseResult parseBinaryCommand(const uint8_t* data, size_t len, Command& out, size_t& consumed);
+
+// 開始時刻を指定して予約できるコマンドか（状態を変えるコマンドだけ。
+// フレームは受信時にステージへ書くので予約できない）
+bool isSchedulable(CommandType type);
+
+// OP_TIME_PING の応答を out（TIME_REPLY_LENGTH バイト）に書く
+void encodeTimeReply(uint8_t* out, uint32_t hostTime, uint32_t rxTime, uint32_t txTime);
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+// 受信したコマンドの記録（リプレイログ）
+//
+// キャラクタリスティックへの書き込みを受信時刻付きでそのまま記録するリングバッファ。
+// 満杯になったら古い記録から捨てるので、常に直近の N バイト分が残る。
+// 取り出したログは src/host のシミュレータで同じ受信経路に流し直して再現できる。
+//
+// 1件の形式（リトルエンディアン）: [受信時刻 u32 マイクロ秒][長さ u16][書き込まれたバイト列]
+//
+// 書き込み側（BLEコールバック）は待たされない。読み出し側は FrameStage と同じ
+// シーケンスロックで、書き込みと重なったら取り直す。
+
+#define REPLAY_RECORD_HEADER 6
+
+// シリアルへのテキスト出力の形式: 開始行、16進の行（1行 REPLAY_DUMP_LINE_BYTES バイト）、終了行
+#define REPLAY_DUMP_BEGIN "REPLAY BEGIN"
+#define REPLAY_DUMP_END "REPLAY END"
+#define REPLAY_DUMP_LINE_BYTES 32
+
+template <size_t N>
+class ReplayLog {
+  static_assert((N & (N - 1)) == 0, "ReplayLog size must be a power of two");
+
+public:
+  // 書き込み側: 1回の書き込みを記録する（N に収まらないものは記録しない）
+  bool record(uint32_t arrivalUs, const uint8_t* data, size_t len) {
+    size_t total = REPLAY_RECORD_HEADER + len;
+    if (len > 0xFFFF || total > N) {
+      return false;
+    }
+
+    seq_.store(seq_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    // 上書きされる古い記録を捨てる
+    while (head + total - tail > N) {
+      uint32_t oldLen = buffer_[(tail + 4) & (N - 1)] | (buffer_[(tail + 5) & (N - 1)] << 8);
+      tail += REPLAY_RECORD_HEADER + oldLen;
+    }
+
+    const uint8_t header[REPLAY_RECORD_HEADER] = {
+      (uint8_t)arrivalUs, (uint8_t)(arrivalUs >> 8), (uint8_t)(arrivalUs >> 16), (uint8_t)(arrivalUs >> 24),
+      (uint8_t)len, (uint8_t)(len >> 8)
+    };
+    copyIn(head, header, REPLAY_RECORD_HEADER);
+    copyIn(head + REPLAY_RECORD_HEADER, data, len);
+
+    tail_.store(tail, std::memory_order_relaxed);
+    head_.store(head + total, std::memory_order_relaxed);
+    recordedCount_.store(recordedCount_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    seq_.store(seq_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    return true;
+  }
+
+  // 読み出し側: 残っている記録を古い順に out へ書き出してバイト数を返す
+  // 書き込みが続いて取れなかった場合は 0
+  size_t snapshot(uint8_t* out, size_t size) const {
+    for (int attempt = 0; attempt < SNAPSHOT_RETRIES; attempt++) {
+      uint32_t before = seq_.load(std::memory_order_acquire);
+      if (before & 1) {
+        continue; // 書き込み中
+      }
+      uint32_t head = head_.load(std::memory_order_relaxed);
+      uint32_t tail = tail_.load(std::memory_order_relaxed);
+      size_t length = head - tail;
+      if (length > size) {
+        return 0;
+      }
+      copyOut(tail, out, length);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq_.load(std::memory_order_relaxed) == before) {
+        return length;
+      }
+    }
+    return 0;
+  }
+
+  // 記録した書き込みの累計数（捨てたものも含む）
+  uint32_t recordedCount() const { return recordedCount_.load(std::memory_order_relaxed); }
+
+  static constexpr size_t capacity() { return N; }
+
+private:
+  static constexpr int SNAPSHOT_RETRIES = 3;
+
+  // 長さ0の記録はデータのポインタが null のこともあるので、memcpy に渡さない
+  void copyIn(uint32_t offset, const uint8_t* src, size_t len) {
+    if (len == 0) {
+      return;
+    }
+    size_t start = offset & (N - 1);
+    size_t first = len < N - start ? len : N - start;
+    memcpy(&buffer_[start], src, first);
+    memcpy(&buffer_[0], src + first, len - first);
+  }
+
+  void copyOut(uint32_t offset, uint8_t* dst, size_t len) const {
+    if (len == 0) {
+      return;
+    }
+    size_t start = offset & (N - 1);
+    size_t first = len < N - start ? len : N - start;
+    memcpy(dst, &buffer_[start], first);
+    memcpy(dst + first, &buffer_[0], len - first);
+  }
+
+  uint8_t buffer_[N];
+  std::atomic<uint32_t> head_{0}; // 次に書く位置（累計バイト数）
+  std::atomic<uint32_t> tail_{0}; // 最も古い記録の位置
+  std::atomic<uint32_t> recordedCount_{0};
+  std::atomic<uint32_t> seq_{0}; // 奇数なら書き込み中
+};
+
+// snapshot() で取り出したログから offset の位置の1件を読み、offset を次へ進める
+// 残りが足りなければ false
+inline bool nextReplayRecord(const uint8_t* log, size_t logLen, size_t& offset,
+                             uint32_t& arrivalUs, const uint8_t*& data, size_t& len) {
+  if (offset > logLen || logLen - offset < REPLAY_RECORD_HEADER) {
+    return false;
+  }
+  const uint8_t* p = log + offset;
+  arrivalUs = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+  len = (size_t)p[4] | ((size_t)p[5] << 8);
+  if (logLen - offset - REPLAY_RECORD_HEADER < len) {
+    return false;
+  }
+  data = p + REPLAY_RECORD_HEADER;
+  offset += REPLAY_RECORD_HEADER + len;
+  return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <FastLED.h>
+
+// 内容が変わっていないフレームの FastLED.show() を省略する
+//
+// 前回送ったフレーム（leds[] と明るさ）の写しと比べ、同じなら送らない。
+// ノイズなどでLED側の状態が崩れても戻るよう、keepAlive ミリ秒ごとには必ず送る。
+template <size_t N>
+class ShowGate {
+public:
+  explicit ShowGate(uint32_t keepAlive) : keepAlive_(keepAlive) {}
+
+  // 今回のフレームを送るべきなら true（送ったものとして写しを更新する）
+  bool shouldShow(const CRGB* leds, uint8_t brightness, uint32_t now) {
+    bool changed = !valid_ || brightness != brightness_ || memcmp(leds, shown_, sizeof(shown_)) != 0;
+    bool expired = keepAlive_ != 0 && (now - lastShowTime_) >= keepAlive_;
+    if (!changed && !expired) {
+      skippedCount_++;
+      return false;
+    }
+    if (changed) {
+      memcpy(shown_, leds, sizeof(shown_));
+      brightness_ = brightness;
+      valid_ = true;
+    }
+    lastShowTime_ = now;
+    shownCount_++;
+    return true;
+  }
+
+  // 次のフレームを必ず送らせる
+  void invalidate() { valid_ = false; }
+
+  void setKeepAlive(uint32_t keepAlive) { keepAlive_ = keepAlive; }
+
+  // 送ったフレーム数・省略したフレーム数の累計
+  uint32_t shownCount() const { return shownCount_; }
+  uint32_t skippedCount() const { return skippedCount_; }
+
+private:
+  CRGB shown_[N];
+  uint8_t brightness_ = 0;
+  bool valid_ = false;
+  uint32_t keepAlive_;
+  uint32_t lastShowTime_ = 0;
+  uint32_t shownCount_ = 0;
+  uint32_t skippedCount_ = 0;
+};
@@ -0,0 +1,73 @@
+#include "stats.h"
+
+#include <string.h>
+
+void Log2Histogram::reset() {
+  memset(buckets_, 0, sizeof(buckets_));
+  count_ = 0;
+  min_ = UINT32_MAX;
+  max_ = 0;
+  sum_ = 0;
+}
+
+uint32_t Log2Histogram::percentile(uint32_t permille) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  // 全体の permille‰ 個目の値が入っているバケットを探す
+  uint64_t target = ((uint64_t)count_ * permille + 999) / 1000;
+  if (target == 0) {
+    target = 1;
+  }
+  uint64_t seen = 0;
+  for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    seen += buckets_[i];
+    if (seen >= target) {
+      if (i == HISTOGRAM_BUCKETS - 1) {
+        return max_; // 最後のバケットは上限なし
+      }
+      uint32_t upper = (i == 0) ? 0 : (uint32_t)((1ull << i) - 1);
+      return upper < max_ ? upper : max_;
+    }
+  }
+  return max_;
+}
+
+bool StatsWriter::putU8(uint8_t value) {
+  if (size_ - length_ < 1) {
+    return false;
+  }
+  buffer_[length_++] = value;
+  return true;
+}
+
+bool StatsWriter::putU16(uint16_t value) {
+  if (size_ - length_ < 2) {
+    return false;
+  }
+  buffer_[length_++] = (uint8_t)value;
+  buffer_[length_++] = (uint8_t)(value >> 8);
+  return true;
+}
+
+bool StatsWriter::putU32(uint32_t value) {
+  if (size_ - length_ < 4) {
+    return false;
+  }
+  for (int i = 0; i < 4; i++) {
+    buffer_[length_++] = (uint8_t)(value >> (8 * i));
+  }
+  return true;
+}
+
+bool StatsWriter::putSummary(const Log2Histogram& histogram) {
+  if (size_ - length_ < 20) {
+    return false;
+  }
+  putU32(histogram.count());
+  putU32(histogram.min());
+  putU32(histogram.average());
+  putU32(histogram.percentile(990));
+  putU32(histogram.max());
+  return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 計測値の集計
+//
+// 値は2のべき乗ごとのバケット（log2ヒストグラム）に数えるので、
+// 記録は数命令・メモリ確保なしで済み、大きさはバケット数で固定。
+// パーセンタイルはバケットの上限値で近似する。
+
+#define HISTOGRAM_BUCKETS 32
+
+class Log2Histogram {
+public:
+  Log2Histogram() { reset(); }
+
+  void record(uint32_t value) {
+    buckets_[bucketOf(value)]++;
+    count_++;
+    sum_ += value;
+    if (value < min_) {
+      min_ = value;
+    }
+    if (value > max_) {
+      max_ = value;
+    }
+  }
+
+  void reset();
+
+  uint32_t count() const { return count_; }
+  uint32_t min() const { return count_ ? min_ : 0; }
+  uint32_t max() const { return max_; }
+  uint32_t average() const { return count_ ? (uint32_t)(sum_ / count_) : 0; }
+  // permille（‰）パーセンタイルの近似値（例: 990 で p99）
+  uint32_t percentile(uint32_t permille) const;
+
+  // バケット i は [2^(i-1), 2^i - 1] の値を数える（バケット0は値0）
+  uint32_t bucket(size_t i) const { return buckets_[i]; }
+  static size_t bucketOf(uint32_t value) {
+    if (value == 0) {
+      return 0;
+    }
+    size_t i = 32 - __builtin_clz(value);
+    return i < HISTOGRAM_BUCKETS ? i : HISTOGRAM_BUCKETS - 1;
+  }
+
+private:
+  uint32_t buckets_[HISTOGRAM_BUCKETS];
+  uint32_t count_;
+  uint32_t min_;
+  uint32_t max_;
+  uint64_t sum_;
+};
+
+// 統計レポートの書き出し（リトルエンディアン）
+// 書き出し先の残りが足りなければ何も書かずに false を返す
+class StatsWriter {
+public:
+  StatsWriter(uint8_t* buffer, size_t size) : buffer_(buffer), size_(size) {}
+
+  bool putU8(uint8_t value);
+  bool putU16(uint16_t value);
+  bool putU32(uint32_t value);
+  // 件数・最小・平均・p99・最大（各u32、20バイト）
+  bool putSummary(const Log2Histogram& histogram);
+
+  size_t length() const { return length_; }
+
+private:
+  uint8_t* buffer_;
+  size_t size_;
+  size_t length_ = 0;
+};
@@ -0,0 +1,40 @@
+#include "stream.h"
+
+ParseResult parseStreamWrite(const uint8_t* data, size_t len, StreamWrite& out) {
+  if (len == 0) {
+    return PARSE_EMPTY;
+  }
+  if (len <= STREAM_HEADER) {
+    return PARSE_TRUNCATED;
+  }
+  out.seq = (uint16_t)(data[0] | (data[1] << 8));
+  out.write = data + STREAM_HEADER;
+  out.writeLen = len - STREAM_HEADER;
+  return PARSE_OK;
+}
+
+bool StreamSequence::accept(uint16_t seq) {
+  int16_t gap = (int16_t)(seq - expected_);
+  if (started_ && gap < 0 && gap >= -STREAM_REORDER_WINDOW) {
+    stale_++;
+    return false;
+  }
+  // 最初の書き込みと、大きく戻ったもの（ホストが数え直した）は抜けに数えない
+  if (started_ && gap > 0) {
+    lost_ += (uint32_t)gap;
+  }
+  started_ = true;
+  expected_ = seq + 1;
+  lastSeq_ = seq;
+  received_++;
+  return true;
+}
+
+void StreamSequence::reset() {
+  started_ = false;
+  expected_ = 0;
+  lastSeq_ = 0;
+  received_ = 0;
+  lost_ = 0;
+  stale_ = 0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol.h"
+
+// 応答なし書き込み（Write Without Response）のストリーム
+//
+// 制御用のキャラクタリスティックは書き込みごとにATTの応答を待つので、
+// 1往復（接続間隔）に1回しか書けない。ピクセルフレームや音に合わせた色など
+// 高い頻度で送るものは、応答を待たないストリーム用のキャラクタリスティックに書く。
+// 応答がないので届かなかった書き込みはホストに分からない。各書き込みに SEQ を付け、
+// デバイスは抜けた数を数えて統計レポート（STATS_REPORT_STREAM）で返す。
+//
+// ストリームへの書き込みの形式（リトルエンディアン）:
+//   SEQ(u16),書き込み
+// 書き込みは制御用と同じ形式（バッチも可、protocol.h）。SEQ は書き込みごとに1ずつ進める。
+
+#define STREAM_HEADER 2
+
+// SEQ がこの数以内だけ戻ったものは遅れて届いた古い書き込みとして捨てる
+// それより大きく戻ったらホストが数え直したとみなして受け付ける
+#define STREAM_REORDER_WINDOW 32
+
+struct StreamWrite {
+  uint16_t seq;
+  const uint8_t* write; // 受信データ内を指す
+  size_t writeLen;
+};
+
+// ストリームへの書き込みを SEQ と中身に分ける（中身がなければ PARSE_TRUNCATED）
+ParseResult parseStreamWrite(const uint8_t* data, size_t len, StreamWrite& out);
+
+// SEQ による抜け・遅れの検出（BLEのコールバックからだけ呼ぶ）
+class StreamSequence {
+public:
+  // 反映してよい書き込みなら true。抜けた SEQ は lostCount() に数える
+  bool accept(uint16_t seq);
+  // 接続ごとに数え直す
+  void reset();
+
+  uint32_t receivedCount() const { return received_; }
+  // 届かなかった（SEQ が飛んだ）書き込みの数
+  uint32_t lostCount() const { return lost_; }
+  // 遅れて届いた・重複したので捨てた書き込みの数
+  uint32_t staleCount() const { return stale_; }
+  uint16_t lastSeq() const { return lastSeq_; }
+
+private:
+  bool started_ = false;
+  uint16_t expected_ = 0;
+  uint16_t lastSeq_ = 0;
+  uint32_t received_ = 0;
+  uint32_t lost_ = 0;
+  uint32_t stale_ = 0;
+};
@@ -0,0 +1,68 @@
+#include "timeline.h"
+
+#include "easing.h"
+
+void Timeline::clear() {
+  count_ = 0;
+  cursor_ = 0;
+  playing_ = false;
+}
+
+bool Timeline::append(const Keyframe& keyframe) {
+  if (count_ >= TIMELINE_MAX_KEYFRAMES) {
+    return false;
+  }
+  if (count_ > 0 && keyframe.time < keyframes_[count_ - 1].time) {
+    return false;
+  }
+  keyframes_[count_++] = keyframe;
+  return true;
+}
+
+bool Timeline::play(uint32_t now, bool loop) {
+  if (count_ == 0) {
+    return false;
+  }
+  startTime_ = now;
+  cursor_ = 0;
+  loop_ = loop;
+  playing_ = true;
+  return true;
+}
+
+CRGB Timeline::render(uint32_t now) {
+  if (count_ == 0) {
+    playing_ = false;
+    return CRGB(0, 0, 0);
+  }
+
+  uint32_t t = now - startTime_;
+  uint32_t length = keyframes_[count_ - 1].time;
+  if (loop_ && length > 0) {
+    t %= length;
+    if (t < keyframes_[cursor_].time) {
+      cursor_ = 0; // 先頭に戻った
+    }
+  }
+
+  // 現在の区間まで進める（フレームごとに高々数回）
+  while (cursor_ + 1 < count_ && keyframes_[cursor_ + 1].time <= t) {
+    cursor_++;
+  }
+
+  const Keyframe& from = keyframes_[cursor_];
+  if (t < from.time) {
+    // 最初のキーフレームより前は最初の色を保持
+    return from.color;
+  }
+  if (cursor_ + 1 >= count_) {
+    // 最後のキーフレームに到達
+    if (!loop_ || length == 0) {
+      playing_ = false;
+    }
+    return from.color;
+  }
+
+  const Keyframe& to = keyframes_[cursor_ + 1];
+  return easeColor(from.color, to.color, t - from.time, to.time - from.time, to.easing);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <FastLED.h>
+
+#include "easing.h"
+
+// キーフレームタイムライン
+//
+// ホストがキーフレームを事前確保したバッファに書き込み、再生コマンド1つで開始する。
+// 再生中はBLE通信なしで、millis() から各キーフレーム間の色を補間して求める。
+
+// 保持できるキーフレームの最大数
+#define TIMELINE_MAX_KEYFRAMES 32
+
+struct Keyframe {
+  uint32_t time;  // 再生開始からの時刻（ミリ秒）
+  CRGB color;
+  uint8_t easing; // そのキーフレームに向かう区間の補間方法（Easing）
+};
+
+class Timeline {
+public:
+  // キーフレームを全て削除して再生を止める
+  void clear();
+  // 末尾にキーフレームを追加する（満杯、または時刻が前のキーフレームより前なら false）
+  bool append(const Keyframe& keyframe);
+
+  // now から再生を開始する（キーフレームがなければ false）
+  bool play(uint32_t now, bool loop);
+  void stop() { playing_ = false; }
+  bool playing() const { return playing_; }
+  size_t size() const { return count_; }
+
+  // now の時点の色を返す。ループなしで最後まで再生したら停止する
+  CRGB render(uint32_t now);
+
+private:
+  Keyframe keyframes_[TIMELINE_MAX_KEYFRAMES];
+  size_t count_ = 0;
+  size_t cursor_ = 0; // 現在の区間（keyframes_[cursor_] 以降を再生中）
+  uint32_t startTime_ = 0;
+  bool loop_ = false;
+  bool playing_ = false;
+};
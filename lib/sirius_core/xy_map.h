@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 2次元座標 (x, y) → LEDの画素番号の対応表
+//
+// StripLayout のセグメントを行（y）、セグメント内の位置を列（x）とみなす。
+// 表はコンパイル時に作られて .rodata（フラッシュ）に置かれるので、
+// 1画素の変換は表を1回読むだけ。
+
+// セグメントの配線
+enum XyWiring : uint8_t {
+  XY_ROW_MAJOR,  // 全セグメントが同じ向き
+  XY_SERPENTINE, // 奇数番目のセグメントが逆向き（折り返し配線）
+};
+
+template <typename Layout, XyWiring Wiring>
+struct XyMap {
+  using layout = Layout;
+  static constexpr size_t WIDTH = Layout::SEGMENT_LENGTH;
+  static constexpr size_t HEIGHT = Layout::SEGMENTS;
+  static_assert(Layout::PIXELS <= UINT16_MAX, "XyMap indexes pixels with uint16_t");
+
+  struct Table {
+    uint16_t xy[HEIGHT][WIDTH];
+  };
+
+  static constexpr Table makeTable() {
+    Table table{};
+    for (size_t y = 0; y < HEIGHT; y++) {
+      for (size_t x = 0; x < WIDTH; x++) {
+        size_t column = (Wiring == XY_SERPENTINE && (y & 1)) ? WIDTH - 1 - x : x;
+        table.xy[y][x] = (uint16_t)Layout::pixel(y, column);
+      }
+    }
+    return table;
+  }
+
+  static constexpr Table TABLE = makeTable();
+
+  // (x, y) の画素番号（範囲外は呼び出し側で避ける）
+  static constexpr size_t index(size_t x, size_t y) {
+    return TABLE.xy[y][x];
+  }
+};
@@ -5,7 +5,7 @@ a = Analysis(
     ['sirius3_led_controller.py'],
     pathex=[],
     binaries=[],
-    datas=[('sirius3_led_animations.py', '.')],
+    datas=[('sirius3_led_animations.py', '.'), ('sirius3_protocol.py', '.')],
     hiddenimports=[],
     hookspath=[],
     hooksconfig={},
@@ -4,6 +4,8 @@ import logging
 from PySide6.QtCore import QObject, Signal
 from PySide6.QtGui import QColor
 
+from sirius3_protocol import EFFECT_BLINK, EFFECT_PULSE
+
 class AnimationSignals(QObject):
     """アニメーション状態を通知するためのシグナル"""
     animation_started = Signal(str)  # アニメーション開始時（アニメーション名）
@@ -260,26 +262,12 @@ class LEDAnimation:
                 self.ble_controller.set_mode(opposite_device, False)  # 固定色モードに設定
                 self.logger.debug(f"{opposite_device}デバイスを消灯状態に設定")
             
-            count = 0
-            while not self.stop_event.is_set() and count < cycles:
-                # 点灯
-                self.ble_controller.set_transition_color(
-                    target_device, r, g, b, transition_time)
-                
-                # 点灯状態を保持
-                time.sleep(speed)
-                
-                if self.stop_event.is_set():
-                    break
-                
-                # 消灯
-                self.ble_controller.set_transition_color(
-                    target_device, 0, 0, 0, transition_time)
-                
-                # 消灯状態を保持
-                time.sleep(speed)
-                
-                count += 1
+            # 点滅はデバイス側で再生する（コマンドは1回だけ）
+            self.ble_controller.start_effect(
+                target_device, EFFECT_BLINK, r, g, b, int(speed * 1000), cycles, transition_time)
+            
+            # 再生が終わるまで待機（停止要求があれば中断）
+            self.stop_event.wait(speed * 2 * cycles)
                 
             # アニメーション終了、消灯状態に
             if not self.stop_event.is_set():
@@ -328,36 +316,18 @@ class LEDAnimation:
             color = self.custom_colors.get(animation_type, self.color_amber)
             r, g, b = color.red(), color.green(), color.blue()
             
-            count = 0
-            while not self.stop_event.is_set() and count < cycles:
-                # 両方点灯
-                commands = []
-                if left_connected:
-                    commands.append(("LEFT", "T", (r, g, b, transition_time)))
-                if right_connected:
-                    commands.append(("RIGHT", "T", (r, g, b, transition_time)))
-                
-                self.ble_controller._send_commands_simultaneously(commands)
-                
-                # 点灯状態を保持
-                time.sleep(speed)
-                
-                if self.stop_event.is_set():
-                    break
-                
-                # 両方消灯
-                commands = []
-                if left_connected:
-                    commands.append(("LEFT", "T", (0, 0, 0, transition_time)))
-                if right_connected:
-                    commands.append(("RIGHT", "T", (0, 0, 0, transition_time)))
-                
-                self.ble_controller._send_commands_simultaneously(commands)
-                
-                # 消灯状態を保持
-                time.sleep(speed)
-                
-                count += 1
+            # 両方の点滅はデバイス側で再生する（各デバイスにコマンドは1回だけ）
+            effect = (EFFECT_BLINK, r, g, b, int(speed * 1000), cycles, transition_time)
+            commands = []
+            if left_connected:
+                commands.append(("LEFT", "E", effect))
+            if right_connected:
+                commands.append(("RIGHT", "E", effect))
+            
+            self.ble_controller._send_commands_simultaneously(commands)
+            
+            # 再生が終わるまで待機（停止要求があれば中断）
+            self.stop_event.wait(speed * 2 * cycles)
                 
             # アニメーション終了、消灯状態に
             if not self.stop_event.is_set():
@@ -406,36 +376,18 @@ class LEDAnimation:
             color = self.custom_colors.get("emergency", self.color_red)
             r, g, b = color.red(), color.green(), color.blue()
             
-            count = 0
-            while not self.stop_event.is_set() and count < cycles:
-                # 両方点灯
-                commands = []
-                if left_connected:
-                    commands.append(("LEFT", "T", (r, g, b, transition_time)))
-                if right_connected:
-                    commands.append(("RIGHT", "T", (r, g, b, transition_time)))
-                
-                self.ble_controller._send_commands_simultaneously(commands)
-                
-                # 点灯状態を保持
-                time.sleep(speed)
-                
-                if self.stop_event.is_set():
-                    break
-                
-                # 両方消灯
-                commands = []
-                if left_connected:
-                    commands.append(("LEFT", "T", (0, 0, 0, transition_time)))
-                if right_connected:
-                    commands.append(("RIGHT", "T", (0, 0, 0, transition_time)))
-                
-                self.ble_controller._send_commands_simultaneously(commands)
-                
-                # 消灯状態を保持
-                time.sleep(speed)
-                
-                count += 1
+            # 両方の点滅はデバイス側で再生する（各デバイスにコマンドは1回だけ）
+            effect = (EFFECT_BLINK, r, g, b, int(speed * 1000), cycles, transition_time)
+            commands = []
+            if left_connected:
+                commands.append(("LEFT", "E", effect))
+            if right_connected:
+                commands.append(("RIGHT", "E", effect))
+            
+            self.ble_controller._send_commands_simultaneously(commands)
+            
+            # 再生が終わるまで待機（停止要求があれば中断）
+            self.stop_event.wait(speed * 2 * cycles)
                 
             # アニメーション終了、消灯状態に
             if not self.stop_event.is_set():
@@ -488,34 +440,21 @@ class LEDAnimation:
                 
             r, g, b = color.red(), color.green(), color.blue()
             
-            # 一回のアニメーション（フェードイン・フェードアウト）
-            # フェードイン
+            # 一回のアニメーション（フェードイン・フェードアウト）をデバイス側で再生
+            # 点灯 speed*2 秒（フェードイン transition_time*2）、消灯 speed*3 秒（フェードアウト transition_time*3）
+            effect = (EFFECT_PULSE, r, g, b, int(speed * 1000), 1, transition_time)
             commands = []
             if left_connected:
-                commands.append(("LEFT", "T", (r, g, b, transition_time * 2)))
+                commands.append(("LEFT", "E", effect))
             if right_connected:
-                commands.append(("RIGHT", "T", (r, g, b, transition_time * 2)))
+                commands.append(("RIGHT", "E", effect))
             
             self.ble_controller._send_commands_simultaneously(commands)
             
-            # フェードイン待機
-            time.sleep(speed * 2)
-            
-            if self.stop_event.is_set():
+            # 再生が終わるまで待機（停止要求があれば中断）
+            if self.stop_event.wait(speed * 5):
                 return
             
-            # フェードアウト
-            commands = []
-            if left_connected:
-                commands.append(("LEFT", "T", (0, 0, 0, transition_time * 3)))
-            if right_connected:
-                commands.append(("RIGHT", "T", (0, 0, 0, transition_time * 3)))
-            
-            self.ble_controller._send_commands_simultaneously(commands)
-            
-            # フェードアウト待機
-            time.sleep(speed * 3)
-            
             # アニメーション終了
             if not self.stop_event.is_set():
                 # 両方のデバイスに対して消灯コマンドを送信
@@ -26,6 +26,7 @@ from PySide6.QtGui import QColor, QPainter, QBrush, QTextCursor, QFont, QIcon
 
 # シリウス3アニメーションをインポート
 from sirius3_led_animations import LEDAnimation
+from sirius3_protocol import encode_command
 
 # BLEデバイス情報
 DEVICE_NAMES = {
@@ -42,6 +43,10 @@ CMD_MODE = "M"      # モード設定 (0:固定色、1:自動色相変化)
 CMD_COLOR = "C"     # RGB色設定
 CMD_HUE = "H"       # 色相設定
 CMD_TRANSITION = "T" # 色遷移設定
+CMD_EFFECT = "E"     # エフェクト開始（デバイス側で再生）
+
+# バイナリコマンド形式で送信するか（Falseで従来のASCII形式）
+USE_BINARY_PROTOCOL = True
 
 # ロギング設定
 class QTextEditLogger(logging.Handler):
@@ -101,6 +106,14 @@ class LogTextEdit(QTextEdit):
             return True
         return super().event(event)
         
+def encode_payload(cmd_type, value, command_str):
+    """コマンドを送信用のバイト列に変換する（バイナリ形式が使えない場合はASCII）"""
+    if USE_BINARY_PROTOCOL:
+        payload = encode_command(cmd_type, value)
+        if payload is not None:
+            return payload
+    return command_str.encode()
+
 # BLEコマンドキュー項目
 class BLECommand:
     """BLEデバイスに送信するコマンド"""
@@ -119,8 +132,14 @@ class BLECommand:
         elif self.cmd_type == CMD_TRANSITION:
             r, g, b, duration = self.value
             return f"{self.cmd_type}:{r},{g},{b},{duration}"
+        elif self.cmd_type == CMD_EFFECT:
+            return f"{self.cmd_type}:{','.join(str(v) for v in self.value)}"
         else:
             return f"{self.cmd_type}:{self.value}"
+
+    def get_command_bytes(self):
+        """送信するバイト列を返す"""
+        return encode_payload(self.cmd_type, self.value, self.get_command_string())
             
     def __str__(self):
         return f"BLECommand({self.device_key}, {self.get_command_string()})"
@@ -347,6 +366,7 @@ class BLEController(QObject):
         """BLEコマンドを実行"""
         device_key = command.device_key
         command_str = command.get_command_string()
+        payload = command.get_command_bytes()
         
         try:
             # デバイス取得（スレッドセーフに）
@@ -361,7 +381,7 @@ class BLEController(QObject):
             async def send_command():
                 try:
                     self._log(logging.DEBUG, f"{device_key}デバイスにコマンド送信開始: {command_str}")
-                    await client.write_gatt_char(CHARACTERISTIC_UUID, command_str.encode())
+                    await client.write_gatt_char(CHARACTERISTIC_UUID, payload)
                     self._log(logging.DEBUG, f"{device_key}デバイスにコマンド送信完了: {command_str}")
                     return True
                 except Exception as e:
@@ -542,6 +562,10 @@ class BLEController(QObject):
         """指定した色へ滑らかに遷移"""
         self.enqueue_command(device_key, CMD_TRANSITION, (r, g, b, duration), callback)
     
+    def start_effect(self, device_key, effect_type, r, g, b, period, cycles, fade, callback=None):
+        """デバイス側でエフェクトを再生（period/fadeはミリ秒、cycles=0で無限）"""
+        self.enqueue_command(device_key, CMD_EFFECT, (effect_type, r, g, b, period, cycles, fade), callback)
+    
     def apply_settings(self, device_key, auto_mode, r=0, g=0, b=0, hue=0, callback=None):
         """設定を適用"""
         if auto_mode:
@@ -621,10 +645,13 @@ class BLEController(QObject):
                 elif cmd_type == CMD_TRANSITION:
                     r, g, b, duration = value
                     command_str = f"{cmd_type}:{r},{g},{b},{duration}"
+                elif cmd_type == CMD_EFFECT:
+                    command_str = f"{cmd_type}:{','.join(str(v) for v in value)}"
                 else:
                     command_str = f"{cmd_type}:{value}"
                 
-                prepared_commands.append((device_key, client, command_str))
+                payload = encode_payload(cmd_type, value, command_str)
+                prepared_commands.append((device_key, client, command_str, payload))
                 command_strs.append(f"{device_key}:{command_str}")
                 
             except Exception as e:
@@ -640,9 +667,9 @@ class BLEController(QObject):
         # 全てのコマンドを同時に送信するコルーチン
         async def send_all_commands():
             tasks = []
-            for device_key, client, command_str in prepared_commands:
+            for device_key, client, command_str, payload in prepared_commands:
                 # 各デバイスごとにタスクを作成
-                task = asyncio.create_task(self._async_send_command(device_key, client, command_str))
+                task = asyncio.create_task(self._async_send_command(device_key, client, command_str, payload))
                 tasks.append(task)
             
             # 全てのタスクが完了するのを待機
@@ -668,11 +695,11 @@ class BLEController(QObject):
         
         future.add_done_callback(on_done)
     
-    async def _async_send_command(self, device_key, client, command_str):
+    async def _async_send_command(self, device_key, client, command_str, payload):
         """単一コマンドを非同期で送信"""
         try:
             self._log(logging.DEBUG, f"{device_key}デバイスにコマンド送信開始: {command_str}")
-            await client.write_gatt_char(CHARACTERISTIC_UUID, command_str.encode())
+            await client.write_gatt_char(CHARACTERISTIC_UUID, payload)
             self._log(logging.DEBUG, f"{device_key}デバイスにコマンド送信完了: {command_str}")
             return True
         except Exception as e:
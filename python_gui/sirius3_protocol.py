@@ -0,0 +1,405 @@
+"""Sirius3 LED ファームウェアのバイナリコマンドエンコーダ
+
+ファームウェア側の lib/sirius_core/protocol.h と対応する。
+1回の書き込みは PROTOCOL_MAGIC + [オペコード][ペイロード] の形式で、
+ペイロードは固定長・リトルエンディアン。
+"""
+import struct
+
+# バイナリ形式を示す先頭バイト
+PROTOCOL_MAGIC = 0xA5
+
+# オペコード
+OP_COLOR = 0x01       # R,G,B
+OP_HUE = 0x02         # HUE
+OP_MODE = 0x03        # MODE（1:自動色相変化、0:固定色）
+OP_TRANSITION = 0x04  # R,G,B,TIME(u16 ms)
+OP_FRAME = 0x05       # [LEN] START,(R,G,B)*n
+OP_FRAME_DELTA = 0x06 # [LEN] スパン列（差分フレーム）
+OP_EFFECT = 0x07      # TYPE,R,G,B,PERIOD(u16 ms),CYCLES,FADE(u16 ms)
+OP_TIMELINE_CLEAR = 0x08  # (なし)
+OP_TIMELINE_KEY = 0x09    # TIME(u32 ms),R,G,B,EASING
+OP_TIMELINE_PLAY = 0x0A   # FLAGS(bit0:ループ)
+OP_TRANSITION_EASED = 0x0B  # R,G,B,TIME(u16 ms),EASING
+OP_STATS_REQUEST = 0x0C     # REPORT,FLAGS(bit0:リセット,bit1:シリアル出力)
+OP_TIME_PING = 0x0D         # HOST_TIME(u32 ms)  応答は通知（decode_time_reply）
+OP_TIME_SET = 0x0E          # OFFSET(u32 ms)  共有時計 = デバイスの millis() + OFFSET
+OP_AT = 0x0F                # [LEN] TIME(u32 ms),オペコード,ペイロード  共有時計の TIME に実行
+
+# エフェクトの種類（ファームウェアの effects.h と対応）
+EFFECT_BLINK = 0  # 点滅: 点灯=消灯=period、フェード=fade
+EFFECT_PULSE = 1  # フェードイン・アウト: 点灯=2*period、消灯=3*period
+EFFECT_SWEEP = 2  # 縦方向のスイープ: 上の行から順に点灯（タイミングは点滅と同じ）
+EFFECT_CHASE = 3  # 行に沿ったチェイス（流れるウィンカー）: 左の列から順に点灯
+EFFECT_CHASE_REVERSE = 4  # EFFECT_CHASE の逆向き
+
+# イージング（ファームウェアの easing.h と対応）。T:コマンドとキーフレームで共通
+EASE_LINEAR = 0
+EASE_STEP = 1
+EASE_IN_QUAD = 2
+EASE_OUT_QUAD = 3
+EASE_IN_OUT_QUAD = 4
+EASE_IN_CUBIC = 5
+EASE_OUT_CUBIC = 6
+EASE_IN_OUT_CUBIC = 7
+EASE_IN_SINE = 8
+EASE_OUT_SINE = 9
+EASE_IN_OUT_SINE = 10
+EASE_IN_EXPO = 11
+EASE_OUT_EXPO = 12
+EASE_IN_OUT_EXPO = 13
+
+# デバイスが保持できるキーフレームの最大数
+TIMELINE_MAX_KEYFRAMES = 32
+
+# 差分フレームのスパン
+DELTA_RUN_FLAG = 0x80   # COUNTに立てると同じ色のラン
+DELTA_COUNT_MAX = 0x7F
+DELTA_MIN_RUN = 3       # これ未満の連続はリテラルで送る
+
+# 統計レポート（統計キャラクタリスティックから読み出す）
+STATS_CHARACTERISTIC_UUID = "beb5483e-36e1-4688-b7f5-ea07361b26a9"
+STATS_REPORT_LATENCY = 0
+STATS_REPORT_PROFILE = 1
+STATS_REPORT_STREAM = 2
+STATS_FLAG_RESET = 0x01
+STATS_FLAG_SERIAL = 0x02
+
+# STATS_REPORT_PROFILE の区間（ファームウェアの ProfileStage の順）
+PROFILE_STAGES = ("drain", "effect", "compose", "show", "log", "idle")
+
+# ストリーム（応答なし書き込み）用のキャラクタリスティック
+# 書き込みの先頭に SEQ(u16) を付ける（encode_stream）
+STREAM_CHARACTERISTIC_UUID = "beb5483e-36e1-4688-b7f5-ea07361b26aa"
+
+# OP_TIME_PING の応答の長さ
+TIME_REPLY_LENGTH = 14
+
+# アドバタイズによる配信（ファームウェアの broadcast.h と対応）
+BROADCAST_COMPANY_ID = 0xFFFF
+BROADCAST_TAG = 0x53
+BROADCAST_TARGET_ALL = 0xFF
+BROADCAST_DATA_MAX = 29  # アドバタイズデータ31バイトのうちメーカー固有データに使える長さ
+
+# 1ペイロードの最大長（長さフィールドが1バイト）
+MAX_PAYLOAD = 255
+
+# 1回の書き込みに入れられるコマンドの最大数（ファームウェアの COMMAND_BATCH_MAX）
+COMMAND_BATCH_MAX = 16
+# MTUの交換をしていないときのATT MTU（1回の書き込みは MTU - 3 バイト）
+DEFAULT_ATT_MTU = 23
+
+
+def _u8(value):
+    """0-255に丸める"""
+    return max(0, min(255, int(value)))
+
+
+def encode_color(r, g, b):
+    """固定色コマンド（5バイト）"""
+    return bytes((PROTOCOL_MAGIC, OP_COLOR, _u8(r), _u8(g), _u8(b)))
+
+
+def encode_hue(hue):
+    """色相コマンド（3バイト）"""
+    return bytes((PROTOCOL_MAGIC, OP_HUE, _u8(hue)))
+
+
+def encode_mode(auto_mode):
+    """モード切替コマンド（3バイト）"""
+    return bytes((PROTOCOL_MAGIC, OP_MODE, 1 if int(auto_mode) == 1 else 0))
+
+
+# バイナリ形式の色遷移で送れる遷移時間の上限（ミリ秒、TIME は u16）
+TRANSITION_DURATION_MAX = 0xFFFF
+
+
+def encode_transition(r, g, b, duration, easing=EASE_LINEAR):
+    """色遷移コマンド（線形なら7バイト、イージング付きは8バイト）
+
+    duration が TRANSITION_DURATION_MAX を超える場合は ValueError
+    （ASCII の T: は u32 まで送れるので、長い遷移はそちらを使う）。
+    """
+    duration = int(duration)
+    if not 0 <= duration <= TRANSITION_DURATION_MAX:
+        raise ValueError("transition duration out of range for the binary protocol")
+    if easing == EASE_LINEAR:
+        return bytes((PROTOCOL_MAGIC, OP_TRANSITION, _u8(r), _u8(g), _u8(b))) + struct.pack("<H", duration)
+    return (bytes((PROTOCOL_MAGIC, OP_TRANSITION_EASED, _u8(r), _u8(g), _u8(b)))
+            + struct.pack("<HB", duration, int(easing)))
+
+
+def encode_effect(effect_type, r, g, b, period, cycles, fade):
+    """エフェクト開始コマンド（11バイト）。cycles=0 で停止コマンドまで繰り返す"""
+    period = max(0, min(0xFFFF, int(period)))
+    fade = max(0, min(0xFFFF, int(fade)))
+    return (bytes((PROTOCOL_MAGIC, OP_EFFECT, int(effect_type), _u8(r), _u8(g), _u8(b)))
+            + struct.pack("<HBH", period, _u8(cycles), fade))
+
+
+def encode_timeline(keyframes, loop=False):
+    """キーフレームタイムラインのアップロードと再生開始のコマンド列
+
+    keyframes は (time_ms, r, g, b, easing) のシーケンス（時刻の昇順）。
+    1書き込みに1コマンドずつ送るバイト列のリストを返す。
+    """
+    if len(keyframes) > TIMELINE_MAX_KEYFRAMES:
+        raise ValueError("too many keyframes")
+    commands = [bytes((PROTOCOL_MAGIC, OP_TIMELINE_CLEAR))]
+    for time_ms, r, g, b, easing in keyframes:
+        commands.append(bytes((PROTOCOL_MAGIC, OP_TIMELINE_KEY))
+                        + struct.pack("<I", int(time_ms))
+                        + bytes((_u8(r), _u8(g), _u8(b), int(easing))))
+    commands.append(bytes((PROTOCOL_MAGIC, OP_TIMELINE_PLAY, 1 if loop else 0)))
+    return commands
+
+
+def encode_frame(pixels, start=0):
+    """ピクセルフレームコマンド（leds[start:] を pixels で上書き）
+
+    pixels は (r, g, b) のシーケンス。48画素の全体フレームで148バイトになるため、
+    デフォルトの23バイトMTUでは送れない（MTUの拡張が必要）。
+    """
+    payload = bytearray((start,))
+    for r, g, b in pixels:
+        payload += bytes((_u8(r), _u8(g), _u8(b)))
+    if len(payload) > MAX_PAYLOAD:
+        raise ValueError("frame too large")
+    return bytes((PROTOCOL_MAGIC, OP_FRAME, len(payload))) + bytes(payload)
+
+
+def encode_delta_frame(prev, pixels):
+    """差分ピクセルフレームコマンド（prev から pixels への変化分だけ送る）
+
+    ファームウェアの encodeDeltaFrame() と同じ規則でスパンを作る。
+    変化がなければペイロードは空になる。
+    """
+    prev = [tuple(p) for p in prev]
+    pixels = [tuple(p) for p in pixels]
+    n = len(pixels)
+    payload = bytearray()
+    i = 0
+    while i < n:
+        if prev[i] == pixels[i]:
+            i += 1
+            continue
+
+        run = 1
+        while i + run < n and run < DELTA_COUNT_MAX and pixels[i + run] == pixels[i]:
+            run += 1
+        if run >= DELTA_MIN_RUN:
+            payload += bytes((i, DELTA_RUN_FLAG | run)) + bytes(_u8(c) for c in pixels[i])
+            i += run
+            continue
+
+        count = 1
+        while i + count < n and count < DELTA_COUNT_MAX and prev[i + count] != pixels[i + count]:
+            ahead = 1
+            while (i + count + ahead < n and ahead < DELTA_MIN_RUN
+                   and pixels[i + count + ahead] == pixels[i + count]):
+                ahead += 1
+            if ahead >= DELTA_MIN_RUN:
+                break
+            count += 1
+        payload += bytes((i, count))
+        for r, g, b in pixels[i:i + count]:
+            payload += bytes((_u8(r), _u8(g), _u8(b)))
+        i += count
+
+    if len(payload) > MAX_PAYLOAD:
+        raise ValueError("delta frame too large")
+    return bytes((PROTOCOL_MAGIC, OP_FRAME_DELTA, len(payload))) + bytes(payload)
+
+
+def encode_stats_request(report=STATS_REPORT_LATENCY, reset=False, serial=False):
+    """統計レポート要求コマンド（4バイト）
+
+    デバイスは統計キャラクタリスティックを更新して通知する。
+    通知はMTUで切り詰められるので、全体は読み出しで取得する。
+    """
+    flags = (STATS_FLAG_RESET if reset else 0) | (STATS_FLAG_SERIAL if serial else 0)
+    return bytes((PROTOCOL_MAGIC, OP_STATS_REQUEST, _u8(report), flags))
+
+
+def _decode_summary(data, offset):
+    count, minimum, average, p99, maximum = struct.unpack_from("<5I", data, offset)
+    return {"count": count, "min": minimum, "avg": average, "p99": p99, "max": maximum}
+
+
+def decode_latency_report(data):
+    """STATS_REPORT_LATENCY の読み出し結果を辞書にする（時間はマイクロ秒）"""
+    data = bytes(data)
+    if len(data) < 2 or data[0] != STATS_REPORT_LATENCY:
+        raise ValueError("not a latency report")
+    report = {
+        "version": data[1],
+        "queue": _decode_summary(data, 2),
+        "show": _decode_summary(data, 22),
+        "total": _decode_summary(data, 42),
+    }
+    (report["queue_pushed"], report["queue_dropped"],
+     report["frames_shown"], report["frames_skipped"],
+     report["overruns"], report["max_overrun"],
+     report["log_dropped"]) = struct.unpack_from("<7I", data, 62)
+    return report
+
+
+def decode_profile_report(data):
+    """STATS_REPORT_PROFILE の読み出し結果を辞書にする（時間はマイクロ秒に換算）"""
+    data = bytes(data)
+    if len(data) < 6 or data[0] != STATS_REPORT_PROFILE:
+        raise ValueError("not a profile report")
+    mhz, budget = struct.unpack_from("<HH", data, 2)
+    mhz = max(1, mhz)
+
+    def to_us(summary):
+        return {key: (value if key == "count" else value / mhz) for key, value in summary.items()}
+
+    stages = {}
+    offset = 6
+    for name in PROFILE_STAGES:
+        stages[name] = to_us(_decode_summary(data, offset))
+        offset += 20
+    return {
+        "version": data[1],
+        "cpu_mhz": mhz,
+        "budget_us": budget,
+        "stages": stages,
+        "frame": to_us(_decode_summary(data, offset)),
+    }
+
+
+def decode_stream_report(data):
+    """STATS_REPORT_STREAM の読み出し結果を辞書にする（接続してからの累計）"""
+    data = bytes(data)
+    if len(data) < 16 or data[0] != STATS_REPORT_STREAM:
+        raise ValueError("not a stream report")
+    received, lost, stale, last_seq = struct.unpack_from("<3IH", data, 2)
+    return {"version": data[1], "received": received, "lost": lost, "stale": stale, "last_seq": last_seq}
+
+
+def encode_stream(seq, write):
+    """ストリーム用キャラクタリスティックへの書き込み（write は encode_* や encode_batches の1つ）
+
+    seq は書き込みごとに1ずつ進め（0xFFFF の次は0）、接続し直したら0から数え直す。
+    応答なし書き込み（bleak なら response=False）で送る。
+    """
+    return struct.pack("<H", int(seq) & 0xFFFF) + bytes(write)
+
+
+def encode_time_ping(host_time):
+    """時刻同期の問い合わせ（6バイト）。host_time は送信時刻（ミリ秒）"""
+    return bytes((PROTOCOL_MAGIC, OP_TIME_PING)) + struct.pack("<I", int(host_time) & 0xFFFFFFFF)
+
+
+def decode_time_reply(data):
+    """OP_TIME_PING の応答を (host_time, rx, tx) にする（rx/tx はデバイスの millis()）"""
+    data = bytes(data)
+    if len(data) < TIME_REPLY_LENGTH or data[0] != PROTOCOL_MAGIC or data[1] != OP_TIME_PING:
+        raise ValueError("not a time reply")
+    return struct.unpack_from("<3I", data, 2)
+
+
+def estimate_time_offset(sent, rx, tx, received):
+    """1回の往復からホストの時計とデバイスの millis() の差を求める
+
+    sent/received はホストの送信・受信時刻、rx/tx はデバイスの受信・応答時刻（ミリ秒）。
+    (offset, round_trip) を返す。offset はホスト時刻 - デバイス時刻で、そのまま
+    encode_time_set() に渡せば共有時計がホストの時計と一致する。
+    往復の短いサンプルほど正確なので、複数回測って round_trip の最小のものを使う。
+    """
+    round_trip = (received - sent) - ((tx - rx) & 0xFFFFFFFF)
+    device_mid = rx + ((tx - rx) & 0xFFFFFFFF) / 2
+    host_mid = sent + (received - sent) / 2
+    return int(round(host_mid - device_mid)) & 0xFFFFFFFF, round_trip
+
+
+def encode_time_set(offset):
+    """共有時計のオフセット設定（6バイト）"""
+    return bytes((PROTOCOL_MAGIC, OP_TIME_SET)) + struct.pack("<I", int(offset) & 0xFFFFFFFF)
+
+
+def encode_at(start_time, command):
+    """command（encode_* のバイト列）を共有時計の start_time に実行させる
+
+    左右のデバイスに同じ start_time を付けて送ると、同じミリ秒から始まる。
+    ピクセルフレーム・統計・時刻同期のコマンドは予約できない。
+    デバイスは encode_time_set() で共有時計を設定するまで予約を受け付けず、
+    60秒（SCHEDULE_AHEAD_MAX_MS）より先の start_time も拒否する。
+    予約は共有時計の設定し直しや、すぐに実行する色・モードなどのコマンドで取り消される。
+    """
+    command = bytes(command)
+    if not command or command[0] != PROTOCOL_MAGIC:
+        raise ValueError("binary command expected")
+    payload = struct.pack("<I", int(start_time) & 0xFFFFFFFF) + command[1:]
+    if len(payload) > MAX_PAYLOAD:
+        raise ValueError("command too large")
+    return bytes((PROTOCOL_MAGIC, OP_AT, len(payload))) + payload
+
+
+def encode_broadcast(seq, command, targets=BROADCAST_TARGET_ALL):
+    """command（encode_* のバイト列）をアドバタイズで配信するメーカー固有データにする
+
+    同じ seq の間はデバイスが1回だけ実行するので、アドバタイズを繰り返し送ってよい。
+    新しいコマンドごとに seq を進める。targets は宛先の DEVICE_ID のビット（bit0 が1）。
+    返すバイト列は先頭2バイトがメーカーID（リトルエンディアン）で、
+    アドバタイズのAD構造（長さ・種別0xFF）はアドバタイズする側で付ける。
+    """
+    command = bytes(command)
+    if not command or command[0] != PROTOCOL_MAGIC:
+        raise ValueError("binary command expected")
+    data = (struct.pack("<HBHB", BROADCAST_COMPANY_ID, BROADCAST_TAG, int(seq) & 0xFFFF, _u8(targets))
+            + command[1:])
+    if len(data) > BROADCAST_DATA_MAX:
+        raise ValueError("command too large for advertising")
+    return data
+
+
+def encode_batches(commands, mtu=DEFAULT_ATT_MTU):
+    """commands（encode_* のバイト列）をできるだけ少ない書き込みにまとめる
+
+    1回の書き込みに入ったコマンドはデバイスで同じフレームに反映される。
+    各書き込みは mtu - 3 バイト・COMMAND_BATCH_MAX 個以内で、コマンドの順番は変えない。
+    交換後のMTUは bleak なら client.mtu_size で分かる。
+    """
+    limit = mtu - 3
+    writes = []
+    current = bytearray()
+    count = 0
+    for command in commands:
+        command = bytes(command)
+        if not command or command[0] != PROTOCOL_MAGIC:
+            raise ValueError("binary command expected")
+        if len(command) > limit:
+            raise ValueError("command too large for MTU")
+        if current and (len(current) + len(command) - 1 > limit or count >= COMMAND_BATCH_MAX):
+            writes.append(bytes(current))
+            current = bytearray()
+            count = 0
+        current += command if not current else command[1:]
+        count += 1
+    if current:
+        writes.append(bytes(current))
+    return writes
+
+
+def encode_command(cmd_type, value):
+    """ASCIIコマンドの種類と値からバイナリコマンドを生成する
+
+    対応していない種類・バイナリ形式で表せない値（65.5秒を超える遷移）の場合は None を返す
+    （呼び出し側は ASCII で送る）
+    """
+    if cmd_type == "C":
+        r, g, b = value
+        return encode_color(r, g, b)
+    if cmd_type == "H":
+        return encode_hue(value)
+    if cmd_type == "M":
+        return encode_mode(value)
+    if cmd_type == "T":
+        if int(value[3]) > TRANSITION_DURATION_MAX:
+            return None
+        return encode_transition(*value)
+    if cmd_type == "E":
+        return encode_effect(*value)
+    return None
@@ -0,0 +1,283 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <FastLED.h>
+
+#include "color_math.h"
+#include "easing.h"
+#include "frame_codec.h"
+#include "led_strip.h"
+#include "protocol.h"
+
+// ベンチマークで塗るLEDの最大数
+#define BENCH_MAX_LEDS 1024
+
+namespace {
+
+CRGB benchLeds[BENCH_MAX_LEDS];
+
+// iterations 回の fn(i) を BENCH_ROUNDS 回測り、1回あたりの最小値を出力する
+template <typename Fn>
+void runCase(const char* name, uint32_t iterations, Fn fn) {
+  uint32_t best = UINT32_MAX;
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    uint32_t start = benchNow();
+    for (uint32_t i = 0; i < iterations; i++) {
+      fn(i);
+    }
+    uint32_t elapsed = benchNow() - start;
+    if (elapsed < best) {
+      best = elapsed;
+    }
+  }
+  // 1回あたりを小数1桁で出す（実機の printf で float を使わないよう10倍の整数で計算）
+  uint32_t perOp10 = (uint32_t)(((uint64_t)best * 10 + iterations / 2) / iterations);
+  char line[96];
+  snprintf(line, sizeof(line), "%-36s %8lu.%lu %s/op",
+           name, (unsigned long)(perOp10 / 10), (unsigned long)(perOp10 % 10), benchUnit());
+  benchPrint(line);
+}
+
+// --- 解析 ---
+
+const char ASCII_COLOR[] = "C:255,128,0";
+const char ASCII_TRANSITION[] = "T:255,128,0,1500,6";
+const uint8_t BINARY_COLOR[] = { PROTOCOL_MAGIC, OP_COLOR, 255, 128, 0 };
+const uint8_t BINARY_TRANSITION[] = { PROTOCOL_MAGIC, OP_TRANSITION_EASED, 255, 128, 0, 0xDC, 0x05, 6 };
+// 4コマンドのバッチ（1回の書き込み）
+const uint8_t BINARY_BATCH[] = { PROTOCOL_MAGIC, OP_MODE, 0, OP_COLOR, 255, 128, 0,
+                                 OP_HUE, 32, OP_TRANSITION_EASED, 255, 128, 0, 0xDC, 0x05, 6 };
+CommandBatch benchBatch;
+
+// 以前の sscanf による解析（比較用）: NUL終端したコピーを作ってから読む
+int parseSscanfReference(const char* text, size_t len, int* values) {
+  char value[64];
+  if (len >= sizeof(value)) {
+    len = sizeof(value) - 1;
+  }
+  memcpy(value, text, len);
+  value[len] = '\0';
+  return sscanf(value + 1, ":%d,%d,%d,%d,%d", &values[0], &values[1], &values[2], &values[3], &values[4]);
+}
+
+void benchParse() {
+  runCase("parse/ascii_color", 2000, [](uint32_t) {
+    Command cmd;
+    parseCommand((const uint8_t*)ASCII_COLOR, sizeof(ASCII_COLOR) - 1, cmd);
+    benchKeep(cmd);
+  });
+  runCase("parse/ascii_transition", 2000, [](uint32_t) {
+    Command cmd;
+    parseCommand((const uint8_t*)ASCII_TRANSITION, sizeof(ASCII_TRANSITION) - 1, cmd);
+    benchKeep(cmd);
+  });
+  runCase("parse/ascii_color_sscanf_ref", 2000, [](uint32_t) {
+    int values[5];
+    int count = parseSscanfReference(ASCII_COLOR, sizeof(ASCII_COLOR) - 1, values);
+    benchKeep(count);
+    benchKeep(values);
+  });
+  runCase("parse/ascii_transition_sscanf_ref", 2000, [](uint32_t) {
+    int values[5];
+    int count = parseSscanfReference(ASCII_TRANSITION, sizeof(ASCII_TRANSITION) - 1, values);
+    benchKeep(count);
+    benchKeep(values);
+  });
+  runCase("parse/binary_color", 2000, [](uint32_t) {
+    Command cmd;
+    parseCommand(BINARY_COLOR, sizeof(BINARY_COLOR), cmd);
+    benchKeep(cmd);
+  });
+  runCase("parse/binary_transition", 2000, [](uint32_t) {
+    Command cmd;
+    parseCommand(BINARY_TRANSITION, sizeof(BINARY_TRANSITION), cmd);
+    benchKeep(cmd);
+  });
+  runCase("parse/binary_batch_4", 2000, [](uint32_t) {
+    parseCommandBatch(BINARY_BATCH, sizeof(BINARY_BATCH), benchBatch);
+    benchKeep(benchBatch);
+  });
+}
+
+// --- 色遷移の補間 ---
+
+// 固定小数点化する前の浮動小数点による補間（比較用）
+CRGB lerpColorFloat(const CRGB& from, const CRGB& to, uint32_t elapsed, uint32_t duration) {
+  if (elapsed >= duration) {
+    return to;
+  }
+  float progress = (float)elapsed / duration;
+  return CRGB(from.r + (to.r - from.r) * progress,
+              from.g + (to.g - from.g) * progress,
+              from.b + (to.b - from.b) * progress);
+}
+
+void benchInterpolate() {
+  const CRGB from(255, 32, 0);
+  const CRGB to(0, 64, 255);
+  const uint32_t duration = 1500;
+
+  runCase("lerp/float", 2000, [&](uint32_t i) {
+    CRGB color = lerpColorFloat(from, to, i % duration, duration);
+    benchKeep(color);
+  });
+  runCase("lerp/fixed", 2000, [&](uint32_t i) {
+    CRGB color = lerpColor(from, to, i % duration, duration);
+    benchKeep(color);
+  });
+  runCase("lerp/fixed_ease_in_out_cubic", 2000, [&](uint32_t i) {
+    CRGB color = easeColor(from, to, i % duration, duration, EASE_IN_OUT_CUBIC);
+    benchKeep(color);
+  });
+}
+
+// --- 塗りつぶし ---
+
+// 先頭の1画素を倍々にコピーして広げる（memset と同じく memcpy の回数が log2(count)）
+void fillDoubling(CRGB* leds, size_t count, const CRGB& color) {
+  if (count == 0) {
+    return;
+  }
+  leds[0] = color;
+  size_t filled = 1;
+  while (filled < count) {
+    size_t chunk = filled < count - filled ? filled : count - filled;
+    memcpy(&leds[filled], leds, chunk * sizeof(CRGB));
+    filled += chunk;
+  }
+}
+
+void benchFillCount(size_t count, const char* solidName, const char* loopName,
+                    const char* doublingName, const char* memsetName) {
+  const CRGB color(255, 128, 0);
+  runCase(solidName, 200, [&](uint32_t) {
+    fill_solid(benchLeds, count, color);
+    benchKeep(benchLeds);
+  });
+  runCase(loopName, 200, [&](uint32_t) {
+    for (size_t i = 0; i < count; i++) {
+      benchLeds[i] = color;
+    }
+    benchKeep(benchLeds);
+  });
+  runCase(doublingName, 200, [&](uint32_t) {
+    fillDoubling(benchLeds, count, color);
+    benchKeep(benchLeds);
+  });
+  // 3色とも同じ値（白・黒・グレー）のときだけ使える上限
+  runCase(memsetName, 200, [&](uint32_t) {
+    memset(benchLeds, 0x80, count * sizeof(CRGB));
+    benchKeep(benchLeds);
+  });
+}
+
+LedStrip<StripLayout<4, 12>> benchStrip;
+
+void benchFill() {
+  // 画素数が定数の LedStrip（実機の耳と同じ48画素）
+  runCase("fill/48_led_strip", 200, [](uint32_t) {
+    benchStrip.fill(CRGB(255, 128, 0));
+    benchKeep(benchStrip);
+  });
+  benchFillCount(48, "fill/48_fill_solid", "fill/48_loop", "fill/48_doubling", "fill/48_memset_gray");
+  benchFillCount(300, "fill/300_fill_solid", "fill/300_loop", "fill/300_doubling", "fill/300_memset_gray");
+  benchFillCount(1024, "fill/1024_fill_solid", "fill/1024_loop", "fill/1024_doubling", "fill/1024_memset_gray");
+}
+
+// --- 差分フレーム ---
+
+// 1回の書き込みのバイト数を出力する
+void printWriteSize(const char* name, size_t bytes) {
+  char line[96];
+  snprintf(line, sizeof(line), "%-36s %8u bytes", name, (unsigned)bytes);
+  benchPrint(line);
+}
+
+CRGB deltaPrev[48];
+CRGB deltaNext[48];
+uint8_t deltaOut[256];
+
+// prev から next への差分フレームを OP_FRAME_DELTA の書き込み（MAGIC,OP,LEN を含む）にしたバイト数
+size_t deltaWriteSize(const CRGB* prev, const CRGB* next) {
+  size_t written = 0;
+  if (!encodeDeltaFrame(prev, next, 48, deltaOut, sizeof(deltaOut), written)) {
+    return 0;
+  }
+  return 3 + written;
+}
+
+void benchDelta() {
+  // 全画素の OP_FRAME（MAGIC,OP,LEN,START + 48画素）
+  printWriteSize("size/full_frame_48", 4 + 48 * 3);
+
+  // 1画素だけ変わる
+  fill_solid(deltaPrev, 48, CRGB(0, 0, 64));
+  memcpy(deltaNext, deltaPrev, sizeof(deltaNext));
+  deltaNext[20] = CRGB(255, 0, 0);
+  printWriteSize("size/delta_48_one_pixel", deltaWriteSize(deltaPrev, deltaNext));
+
+  // 4画素の点灯区間が1画素進む（チェイス）
+  fill_solid(deltaPrev, 48, CRGB::Black);
+  fill_solid(deltaNext, 48, CRGB::Black);
+  fill_solid(&deltaPrev[10], 4, CRGB(255, 128, 0));
+  fill_solid(&deltaNext[11], 4, CRGB(255, 128, 0));
+  printWriteSize("size/delta_48_chase_step", deltaWriteSize(deltaPrev, deltaNext));
+  runCase("delta/encode_48_chase_step", 2000, [](uint32_t) {
+    size_t written = 0;
+    encodeDeltaFrame(deltaPrev, deltaNext, 48, deltaOut, sizeof(deltaOut), written);
+    benchKeep(deltaOut);
+  });
+
+  // 全画素が同じ色に変わる（1つのランにまとまる）
+  fill_solid(deltaNext, 48, CRGB(0, 255, 0));
+  printWriteSize("size/delta_48_solid_change", deltaWriteSize(deltaPrev, deltaNext));
+
+  // 全画素が別々の色に変わる（差分の方が少し長くなる最悪の場合）
+  for (int i = 0; i < 48; i++) {
+    deltaNext[i] = CRGB(i * 5, 255 - i * 5, i);
+  }
+  printWriteSize("size/delta_48_gradient", deltaWriteSize(deltaPrev, deltaNext));
+  runCase("delta/encode_apply_48_gradient", 2000, [](uint32_t) {
+    size_t written = 0;
+    encodeDeltaFrame(deltaPrev, deltaNext, 48, deltaOut, sizeof(deltaOut), written);
+    applyDeltaFrame(deltaOut, written, benchLeds, 48);
+    benchKeep(benchLeds);
+  });
+}
+
+// --- HSV → RGB（MODE_AUTO） ---
+
+CRGB hueTable[256];
+
+void benchHsv() {
+  for (int hue = 0; hue < 256; hue++) {
+    hueTable[hue] = CRGB(CHSV((uint8_t)hue, 255, 255));
+  }
+
+  runCase("hsv/convert", 2000, [](uint32_t i) {
+    CRGB color = CHSV((uint8_t)i, 255, 255);
+    benchKeep(color);
+  });
+  runCase("hsv/table_lookup", 2000, [](uint32_t i) {
+    CRGB color = hueTable[(uint8_t)i];
+    benchKeep(color);
+  });
+  // MODE_AUTO の1フレーム分（変換1回 + 48画素の塗りつぶし）
+  runCase("hsv/auto_frame_48", 200, [](uint32_t i) {
+    fill_solid(benchLeds, 48, CHSV((uint8_t)i, 255, 255));
+    benchKeep(benchLeds);
+  });
+}
+
+} // namespace
+
+void runBenchmarks() {
+  benchPrint("# sirius3 bench");
+  benchParse();
+  benchInterpolate();
+  benchFill();
+  benchDelta();
+  benchHsv();
+  benchPrint("# done");
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+// マイクロベンチマーク
+//
+// 同じケースを実機（CPUサイクル）とホスト（ナノ秒）の両方で動かす。
+// 各ケースは BENCH_ROUNDS 回測って最小値を採るので、割り込みやOSの揺れに左右されにくい。
+// 出力は1ケース1行の固定書式で、実行ごと・環境ごとに並べて比較できる。
+
+// 1ケースを測る回数（最小値を採る）
+#define BENCH_ROUNDS 7
+
+// 環境ごとに用意する（bench_main.cpp）
+uint32_t benchNow();        // 時計（実機はCPUサイクル、ホストはナノ秒）
+const char* benchUnit();    // 時計の単位
+void benchPrint(const char* line);
+
+// 全ケースを実行して結果を benchPrint() に出す
+void runBenchmarks();
+
+// 最適化で計算が消されないようにする
+template <typename T>
+inline void benchKeep(const T& value) {
+  asm volatile("" : : "r"(&value) : "memory");
+}
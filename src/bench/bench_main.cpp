@@ -0,0 +1,62 @@
+// ベンチマークのエントリポイント
+// 実機（env:bench）では起動時に1回実行してシリアルに、ホスト（env:bench_native）では標準出力に出す
+
+#include "bench.h"
+
+#ifdef ARDUINO
+
+#include <Arduino.h>
+#include <esp_cpu.h>
+
+uint32_t benchNow() {
+  return esp_cpu_get_cycle_count();
+}
+
+const char* benchUnit() {
+  return "cycles";
+}
+
+void benchPrint(const char* line) {
+  Serial.println(line);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(2000); // シリアルモニタの接続待ち
+  Serial.printf("# cpu %lu MHz\n", (unsigned long)getCpuFrequencyMhz());
+  runBenchmarks();
+}
+
+void loop() {
+  // シリアルで 'b' を受け取ったらもう一度実行
+  if (Serial.available() > 0 && Serial.read() == 'b') {
+    runBenchmarks();
+  }
+  delay(10);
+}
+
+#else
+
+#include <stdio.h>
+#include <chrono>
+
+uint32_t benchNow() {
+  static const auto start = std::chrono::steady_clock::now();
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - start).count();
+}
+
+const char* benchUnit() {
+  return "ns";
+}
+
+void benchPrint(const char* line) {
+  printf("%s\n", line);
+}
+
+int main() {
+  runBenchmarks();
+  return 0;
+}
+
+#endif
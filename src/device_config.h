@@ -0,0 +1,44 @@
+#pragma once
+
+#include <FastLED.h>
+
+#include "device_profile.h"
+#include "led_strip.h"
+#include "xy_map.h"
+
+// 基板ごとの設定（コンパイル時に決まる）
+//
+// DEVICE_ID は platformio.ini の環境ごとに build_flags で渡す。
+// LEDの数・並び・チップ・ピンはすべて型の引数なので、バッファの大きさや
+// ループ回数は定数になり、実行時のコストはない。
+// 名前・明るさ・並び・中継の役割は lib/sirius_core/device_profile.h（シミュレータと共通）にあり、
+// ここではチップ・データピン・カラー順序を足す。
+// 新しい基板は DeviceProfile<ID> と DeviceConfig<ID> の特殊化を1つずつ足して環境を追加する。
+
+// LEDテープの構成（並び・配線・チップ・データピン・カラー順序）
+template <typename Layout, XyWiring Wiring,
+          template <uint8_t, EOrder> class Chipset, uint8_t Pin, EOrder Order>
+struct StripConfig {
+  using layout = Layout;
+  using Strip = LedStrip<Layout>;
+  using Map = XyMap<Layout, Wiring>;
+
+  static CLEDController& addLeds(Strip& strip) {
+    return FastLED.addLeds<Chipset, Pin, Order>(strip.pixels(), Strip::SIZE);
+  }
+};
+
+template <int Id>
+struct DeviceConfig : DeviceProfile<Id> {};
+
+// 基板1
+template <>
+struct DeviceConfig<1> : DeviceProfile<1> {
+  using Strip = StripConfig<Layout, WIRING, WS2812B, D10, GRB>;
+};
+
+// 基板2
+template <>
+struct DeviceConfig<2> : DeviceProfile<2> {
+  using Strip = StripConfig<Layout, WIRING, WS2812B, D10, GRB>;
+};
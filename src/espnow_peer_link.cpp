@@ -0,0 +1,56 @@
+#include "espnow_peer_link.h"
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include <string.h>
+
+static const uint8_t PEER_BROADCAST_ADDRESS[ESP_NOW_ETH_ALEN] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+EspNowPeerLink* EspNowPeerLink::instance_ = nullptr;
+
+bool EspNowPeerLink::begin(uint8_t channel) {
+  WiFi.mode(WIFI_STA);
+  esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+  if (esp_now_init() != ESP_OK) {
+    return false;
+  }
+
+  esp_now_peer_info_t peer = {};
+  memcpy(peer.peer_addr, PEER_BROADCAST_ADDRESS, ESP_NOW_ETH_ALEN);
+  peer.channel = channel;
+  peer.ifidx = WIFI_IF_STA;
+  peer.encrypt = false;
+  if (esp_now_add_peer(&peer) != ESP_OK) {
+    return false;
+  }
+
+  instance_ = this;
+  return esp_now_register_recv_cb(onReceive) == ESP_OK;
+}
+
+bool EspNowPeerLink::send(const uint8_t* data, size_t len) {
+  return esp_now_send(PEER_BROADCAST_ADDRESS, data, len) == ESP_OK;
+}
+
+bool EspNowPeerLink::receive(uint8_t* data, size_t& len, uint32_t& receivedMs) {
+  Packet packet;
+  if (!inbox_.pop(packet)) {
+    return false;
+  }
+  memcpy(data, packet.data, packet.len);
+  len = packet.len;
+  receivedMs = packet.receivedMs;
+  return true;
+}
+
+void EspNowPeerLink::onReceive(const esp_now_recv_info_t* /*info*/, const uint8_t* data, int len) {
+  if (!instance_ || len <= 0 || len > PEER_PACKET_MAX) {
+    return;
+  }
+  Packet packet;
+  memcpy(packet.data, data, len);
+  packet.len = (uint8_t)len;
+  packet.receivedMs = millis();
+  instance_->inbox_.push(packet);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_now.h>
+
+#include "command_queue.h"
+#include "peer_link.h"
+
+// 受信したパケットを loop() へ渡すキューの長さ（2のべき乗）
+#define ESPNOW_INBOX_SIZE 8
+
+// ESP-NOW によるピアリンク
+//
+// 相手のMACアドレスは設定せずブロードキャストアドレスへ送り、パケットの GROUP で組を見分ける。
+// 受信コールバックはWi-Fiのタスクで呼ばれるので、キューに積むだけにして loop() で取り出す
+// （ログは log.h のキューにどのタスクからでも積めるが、Wi-Fiのタスクを短く済ませるためここでは出さない。
+// 溢れたパケットは droppedCount() で数える）。
+class EspNowPeerLink : public PeerLink {
+public:
+  // Wi-Fi を STA で起動して ESP-NOW を初期化する（接続はしない）
+  bool begin(uint8_t channel);
+
+  bool send(const uint8_t* data, size_t len) override;
+  bool receive(uint8_t* data, size_t& len, uint32_t& receivedMs) override;
+
+  // 受信キューが満杯で捨てたパケット数
+  uint32_t droppedCount() const { return inbox_.droppedCount(); }
+
+private:
+  struct Packet {
+    uint8_t data[PEER_PACKET_MAX];
+    uint8_t len;
+    uint32_t receivedMs;
+  };
+
+  static void onReceive(const esp_now_recv_info_t* info, const uint8_t* data, int len);
+
+  static EspNowPeerLink* instance_;
+  SpscRing<Packet, ESPNOW_INBOX_SIZE> inbox_;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// ネイティブ（ホスト）ビルド用の BLECharacteristic の代用品
+//
+// write() がBLEからの書き込みの代わりで、登録したコールバックの onWrite() を同期で呼ぶ。
+// setValue()/notify() は値と通知回数を覚えておくだけ。
+class FakeCharacteristic;
+
+class FakeCharacteristicCallbacks {
+public:
+  virtual ~FakeCharacteristicCallbacks() = default;
+  virtual void onWrite(FakeCharacteristic* characteristic) = 0;
+};
+
+class FakeCharacteristic {
+public:
+  void setCallbacks(FakeCharacteristicCallbacks* callbacks) { callbacks_ = callbacks; }
+
+  // ホストからの書き込み（セントラル側の write の代わり）
+  void write(const uint8_t* data, size_t len) {
+    value_.assign((const char*)data, len);
+    if (callbacks_) {
+      callbacks_->onWrite(this);
+    }
+  }
+
+  void setValue(const uint8_t* data, size_t len) { value_.assign((const char*)data, len); }
+  std::string getValue() const { return value_; }
+  const uint8_t* getData() const { return (const uint8_t*)value_.data(); }
+  size_t getLength() const { return value_.size(); }
+
+  void notify() {
+    notified_ = value_;
+    notifyCount_++;
+  }
+
+  // 最後に通知した値と通知回数
+  const std::string& notified() const { return notified_; }
+  uint32_t notifyCount() const { return notifyCount_; }
+
+private:
+  FakeCharacteristicCallbacks* callbacks_ = nullptr;
+  std::string value_;
+  std::string notified_;
+  uint32_t notifyCount_ = 0;
+};
@@ -0,0 +1,54 @@
+#include "frame_recorder.h"
+
+#include <string.h>
+
+static FILE* openOutput(const char* path) {
+  if (strcmp(path, "-") == 0) {
+    return stdout;
+  }
+  return fopen(path, "wb");
+}
+
+static void closeOutput(FILE* file) {
+  if (file == stdout) {
+    fflush(file);
+  } else {
+    fclose(file);
+  }
+}
+
+bool FrameRecorder::openPpm(const char* path) {
+  ppm_ = openOutput(path);
+  return ppm_ != nullptr;
+}
+
+bool FrameRecorder::openRaw(const char* path) {
+  raw_ = openOutput(path);
+  return raw_ != nullptr;
+}
+
+void FrameRecorder::onFrame(uint64_t /*timeUs*/, const CRGB* leds, size_t count) {
+  if (raw_) {
+    fwrite(leds, sizeof(CRGB), count, raw_);
+  }
+  if (ppm_) {
+    width_ = count;
+    height_++;
+    const uint8_t* bytes = (const uint8_t*)leds;
+    strip_.insert(strip_.end(), bytes, bytes + count * sizeof(CRGB));
+  }
+}
+
+void FrameRecorder::close() {
+  if (ppm_) {
+    fprintf(ppm_, "P6\n%zu %zu\n255\n", width_, height_);
+    fwrite(strip_.data(), 1, strip_.size(), ppm_);
+    closeOutput(ppm_);
+    ppm_ = nullptr;
+    strip_.clear();
+  }
+  if (raw_) {
+    closeOutput(raw_);
+    raw_ = nullptr;
+  }
+}
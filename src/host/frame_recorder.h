@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#include "simulator.h"
+
+// シミュレータのフレームをファイルに書き出す
+//
+// PPM（P6）: 1フレームを1行とした帯状の画像。横がLED、縦が時間。
+//   フレーム数は最後まで分からないので、close() でまとめて書く。
+// raw: RGB24 の連続ストリーム（1フレーム = LED数 x 3バイト）。そのまま書き流す。
+//   ffmpeg -f rawvideo -pix_fmt rgb24 -s 48x1 -r 60 -i out.rgb で動画にできる。
+class FrameRecorder : public FrameSink {
+public:
+  ~FrameRecorder() override { close(); }
+
+  // path が "-" なら標準出力に書く
+  bool openPpm(const char* path);
+  bool openRaw(const char* path);
+  void close();
+
+  void onFrame(uint64_t timeUs, const CRGB* leds, size_t count) override;
+
+private:
+  FILE* ppm_ = nullptr;
+  FILE* raw_ = nullptr;
+  std::vector<uint8_t> strip_; // PPM用に溜めたフレーム
+  size_t width_ = 0;
+  size_t height_ = 0;
+};
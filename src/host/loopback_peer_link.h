@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+
+#include "peer_link.h"
+
+// ネイティブ（ホスト）ビルド用のピアリンク: 同じプロセス内の2つをつなぐ
+//
+// send() したパケットは PEER_LINK_LATENCY_MS だけ遅れて（仮想時刻で）相手に届く。
+// dropEvery を設定すると N 個に1個を捨てる（ESP-NOW の取りこぼしの代わり）。
+class LoopbackPeerLink : public PeerLink {
+public:
+  static void connect(LoopbackPeerLink& a, LoopbackPeerLink& b) {
+    a.remote_ = &b;
+    b.remote_ = &a;
+  }
+
+  void setDropEvery(uint32_t dropEvery) { dropEvery_ = dropEvery; }
+
+  bool send(const uint8_t* data, size_t len) override {
+    if (!remote_ || len > PEER_PACKET_MAX) {
+      return false;
+    }
+    sent_++;
+    if (dropEvery_ != 0 && sent_ % dropEvery_ == 0) {
+      return true; // 送信側からは届かなかったことは分からない
+    }
+    remote_->inbox_.push_back({ std::vector<uint8_t>(data, data + len), millis() + PEER_LINK_LATENCY_MS });
+    return true;
+  }
+
+  bool receive(uint8_t* data, size_t& len, uint32_t& receivedMs) override {
+    if (inbox_.empty() || (int32_t)(millis() - inbox_.front().receivedMs) < 0) {
+      return false;
+    }
+    const Packet& packet = inbox_.front();
+    len = packet.data.size();
+    memcpy(data, packet.data.data(), len);
+    receivedMs = packet.receivedMs;
+    inbox_.pop_front();
+    return true;
+  }
+
+  uint32_t sentCount() const { return sent_; }
+
+private:
+  struct Packet {
+    std::vector<uint8_t> data;
+    uint32_t receivedMs;
+  };
+
+  LoopbackPeerLink* remote_ = nullptr;
+  std::deque<Packet> inbox_;
+  uint32_t sent_ = 0;
+  uint32_t dropEvery_ = 0;
+};
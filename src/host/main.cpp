@@ -0,0 +1,368 @@
+// ネイティブ（ホスト）ビルドのエントリポイント: LEDシミュレータ
+//
+// 実機の loop() を仮想時計で回し、スクリプトのコマンドを FakeCharacteristic 経由で
+// 実機と同じ受信・反映・描画の経路（frame_engine.h）に通す。実時間は待たないので実機より速く進む。
+//
+//   program [--fps N] [--device ID] [--pair] [--peer-drop N] [--ppm FILE] [--raw FILE] [--record FILE] [SCRIPT]
+//   program [--fps N] [--device ID] [--pair] [--peer-drop N] [--ppm FILE] [--raw FILE] --replay FILE [--speed X] [--tail MS]
+//
+// スクリプト（省略時は標準入力）は1行1コマンド:
+//   C:255,0,0        ASCIIコマンド（そのまま書き込む）
+//   C:0,0,0\nM:1     ASCIIのバッチ（\n を改行にして1回で書き込む）
+//   0xa50100ff00     バイナリコマンド（16進、オペコードを続けて並べるとバッチ）
+//   adv 0xffff53...  アドバタイズで配信されたメーカー固有データ（16進、broadcast.h）
+//   stream 0x0000a5...  ストリーム用キャラクタリスティックへの書き込み（16進、先頭2バイトが SEQ、stream.h）
+//   wait 500         指定ミリ秒だけフレームを進める
+//   at 1500          仮想時刻 1500ミリ秒までフレームを進める
+//   # ...            コメント
+//
+// --record は受信した書き込みをリプレイログ（実機がシリアルに出すのと同じ形式）で保存する。
+// --replay はリプレイログの書き込みを記録された時刻の間隔で流し直す。
+// --speed X で間隔を 1/X に縮め、0 なら待たずに1件ごとに1フレーム進める（スループット計測用）。
+// 最後の書き込みの後は --tail ミリ秒（省略時 1000）だけフレームを進める。
+//
+// --device は配信の宛先の判定に使う DEVICE_ID（省略時 1）。
+// --pair は左右の耳を耳どうしの中継（peer_link.h）でつないで動かす。書き込みはプライマリ（DEVICE_ID 1）
+// にだけ届き、セカンダリ（DEVICE_ID 2）へはループバックのピアリンクで転送される。配信は両方が受け取る。
+// 出力は1フレームに左（プライマリ）・右（セカンダリ）を横に並べる。
+// --peer-drop N でピアリンクのパケットを N 個に1個捨てる。
+//
+// --fps を省略するとフレームは実機と同じモードごとの目標fps（固定色は30fps）で進む。
+// 動画にするときは --fps 60 のように固定すると、1フレームの時間が一定になる。
+//
+// ログと実行結果の要約は標準エラーに出す。
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "frame_recorder.h"
+#include "loopback_peer_link.h"
+#include "log.h"
+#include "replay_file.h"
+#include "replay_log.h"
+#include "simulator.h"
+
+#define SIM_DEFAULT_FPS 0 // 0: 実機と同じモードごとの目標fps
+
+static void flushLogs() {
+  char line[LOG_LINE_MAX];
+  uint8_t level;
+  while (logPop(line, sizeof(line), level)) {
+    fprintf(stderr, "[%8.3f] %s\n", hostClockUs() / 1e6, line);
+  }
+}
+
+// フレームごとに記録し、そのフレームで出たログを仮想時刻付きで出力する
+class SimulationSink : public FrameSink {
+public:
+  explicit SimulationSink(FrameRecorder& recorder) : recorder_(recorder) {}
+
+  void onFrame(uint64_t timeUs, const CRGB* leds, size_t count) override {
+    recorder_.onFrame(timeUs, leds, count);
+    flushLogs();
+  }
+
+private:
+  FrameRecorder& recorder_;
+};
+
+// --pair: 左右の耳のフレームを横に並べて1フレームにする（左がプライマリ）
+// 左右は別々の締め切りで進むので、時刻が変わったときにそれまでの最新の左右を1フレームとして出す
+// （同じ時刻に両方のフレームがあれば1フレームにまとまる）。最後のフレームは flush() で出す。
+class PairSink {
+public:
+  explicit PairSink(FrameSink& out) : out_(out), left_(*this, 0), right_(*this, 1) {}
+
+  FrameSink& left() { return left_; }
+  FrameSink& right() { return right_; }
+
+  void flush() {
+    if (pending_) {
+      out_.onFrame(pendingUs_, frame_, 2 * SimStrip::SIZE);
+      pending_ = false;
+    }
+  }
+
+private:
+  class Side : public FrameSink {
+  public:
+    Side(PairSink& pair, size_t side) : pair_(pair), side_(side) {}
+    void onFrame(uint64_t timeUs, const CRGB* leds, size_t count) override {
+      pair_.onSide(side_, timeUs, leds, count);
+    }
+
+  private:
+    PairSink& pair_;
+    size_t side_;
+  };
+
+  void onSide(size_t side, uint64_t timeUs, const CRGB* leds, size_t count) {
+    if (pending_ && timeUs != pendingUs_) {
+      flush();
+    }
+    memcpy(frame_ + side * SimStrip::SIZE, leds, count * sizeof(CRGB));
+    pendingUs_ = timeUs;
+    pending_ = true;
+  }
+
+  FrameSink& out_;
+  Side left_;
+  Side right_;
+  CRGB frame_[2 * SimStrip::SIZE] = {};
+  uint64_t pendingUs_ = 0;
+  bool pending_ = false;
+};
+
+// "0x" に続く16進文字列をバイト列にする（不正なら空）
+static std::vector<uint8_t> parseHex(const char* hex) {
+  std::vector<uint8_t> bytes;
+  size_t len = strlen(hex);
+  if (len % 2 != 0) {
+    return {};
+  }
+  for (size_t i = 0; i < len; i += 2) {
+    char pair[3] = { hex[i], hex[i + 1], '\0' };
+    char* end;
+    long value = strtol(pair, &end, 16);
+    if (*end != '\0') {
+      return {};
+    }
+    bytes.push_back((uint8_t)value);
+  }
+  return bytes;
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: program [--fps N] [--device ID] [--pair] [--peer-drop N] [--ppm FILE] [--raw FILE] [--record FILE] [SCRIPT]\n"
+          "       program [--fps N] [--device ID] [--pair] [--peer-drop N] [--ppm FILE] [--raw FILE] --replay FILE [--speed X] [--tail MS]\n");
+}
+
+// スクリプトを1行ずつ実行する
+// secondary は --pair のときだけ（配信は両方の耳が受け取る）
+static void runScript(Simulator& simulator, Simulator* secondary, FILE* script) {
+  char line[1024];
+  int lineNumber = 0;
+  while (fgets(line, sizeof(line), script)) {
+    lineNumber++;
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] == '\0' || line[0] == '#') {
+      continue;
+    }
+
+    if (strncmp(line, "wait ", 5) == 0) {
+      uint64_t ms = strtoull(line + 5, nullptr, 10);
+      simulator.runUntil(hostClockUs() + ms * 1000);
+    } else if (strncmp(line, "at ", 3) == 0) {
+      uint64_t ms = strtoull(line + 3, nullptr, 10);
+      simulator.runUntil(ms * 1000);
+    } else if (strncmp(line, "adv 0x", 6) == 0) {
+      std::vector<uint8_t> bytes = parseHex(line + 6);
+      ParseResult result = bytes.empty() ? PARSE_INVALID : simulator.broadcast(bytes.data(), bytes.size());
+      if (secondary && result == PARSE_OK) {
+        secondary->broadcast(bytes.data(), bytes.size());
+      }
+      if (result != PARSE_OK) {
+        fprintf(stderr, "%d行目: 配信データが不正です（%d）: %s\n", lineNumber, result, line);
+      }
+    } else if (strncmp(line, "stream 0x", 9) == 0) {
+      std::vector<uint8_t> bytes = parseHex(line + 9);
+      if (bytes.empty()) {
+        fprintf(stderr, "%d行目: 16進が不正です: %s\n", lineNumber, line);
+        continue;
+      }
+      simulator.streamWrite(bytes.data(), bytes.size());
+    } else if (strncmp(line, "0x", 2) == 0) {
+      std::vector<uint8_t> bytes = parseHex(line + 2);
+      if (bytes.empty()) {
+        fprintf(stderr, "%d行目: 16進が不正です: %s\n", lineNumber, line);
+        continue;
+      }
+      simulator.write(bytes.data(), bytes.size());
+    } else {
+      // "\n" を改行に置き換える（その場で詰める）
+      size_t len = 0;
+      for (size_t i = 0; line[i] != '\0'; i++) {
+        if (line[i] == '\\' && line[i + 1] == 'n') {
+          line[len++] = '\n';
+          i++;
+        } else {
+          line[len++] = line[i];
+        }
+      }
+      simulator.write((const uint8_t*)line, len);
+    }
+    flushLogs();
+  }
+}
+
+// リプレイログの書き込みを流し直す
+static void runReplay(Simulator& simulator, const std::vector<uint8_t>& log, double speed, uint32_t tailMs) {
+  uint64_t base = hostClockUs();
+  uint32_t firstArrival = 0;
+  bool first = true;
+  size_t offset = 0;
+  uint32_t arrivalUs;
+  const uint8_t* data;
+  size_t len;
+  while (nextReplayRecord(log.data(), log.size(), offset, arrivalUs, data, len)) {
+    if (first) {
+      firstArrival = arrivalUs;
+      first = false;
+    }
+    if (speed > 0) {
+      simulator.runUntil(base + (uint64_t)((uint32_t)(arrivalUs - firstArrival) / speed));
+    }
+    simulator.write(data, len);
+    if (speed <= 0) {
+      simulator.runFrames(1);
+    }
+  }
+  if (offset != log.size()) {
+    fprintf(stderr, "リプレイログの末尾が壊れています: %zu/%zuバイト\n", offset, log.size());
+  }
+  simulator.runUntil(hostClockUs() + (uint64_t)tailMs * 1000);
+}
+
+int main(int argc, char** argv) {
+  uint32_t fps = SIM_DEFAULT_FPS;
+  uint8_t deviceId = 1;
+  bool pair = false;
+  uint32_t peerDrop = 0;
+  const char* ppmPath = nullptr;
+  const char* rawPath = nullptr;
+  const char* scriptPath = nullptr;
+  const char* recordPath = nullptr;
+  const char* replayPath = nullptr;
+  double speed = 1.0;
+  uint32_t tailMs = 1000;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+      fps = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--device") == 0 && i + 1 < argc) {
+      deviceId = (uint8_t)strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--pair") == 0) {
+      pair = true;
+    } else if (strcmp(argv[i], "--peer-drop") == 0 && i + 1 < argc) {
+      peerDrop = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--ppm") == 0 && i + 1 < argc) {
+      ppmPath = argv[++i];
+    } else if (strcmp(argv[i], "--raw") == 0 && i + 1 < argc) {
+      rawPath = argv[++i];
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      recordPath = argv[++i];
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      replayPath = argv[++i];
+    } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+      speed = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--tail") == 0 && i + 1 < argc) {
+      tailMs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+      usage();
+      return 2;
+    } else {
+      scriptPath = argv[i];
+    }
+  }
+
+  std::vector<uint8_t> replay;
+  FILE* script = nullptr;
+  if (replayPath) {
+    FILE* file = fopen(replayPath, "r");
+    bool loaded = file && readReplayDump(file, replay);
+    if (file) {
+      fclose(file);
+    }
+    if (!loaded) {
+      fprintf(stderr, "リプレイログを読めません: %s\n", replayPath);
+      return 1;
+    }
+  } else {
+    script = scriptPath ? fopen(scriptPath, "r") : stdin;
+    if (!script) {
+      fprintf(stderr, "スクリプトを開けません: %s\n", scriptPath);
+      return 1;
+    }
+  }
+
+  FrameRecorder recorder;
+  if ((ppmPath && !recorder.openPpm(ppmPath)) || (rawPath && !recorder.openRaw(rawPath))) {
+    fprintf(stderr, "出力ファイルを開けません\n");
+    return 1;
+  }
+
+  SimulationSink sink(recorder);
+  static Simulator simulator(fps, pair ? 1 : deviceId); // リプレイログが大きいのでスタックに置かない
+  simulator.setSink(&sink);
+
+  // --pair: セカンダリの耳とループバックのピアリンク
+  static Simulator secondary(fps, 2);
+  static LoopbackPeerLink primaryLink;
+  static LoopbackPeerLink secondaryLink;
+  static PairSink pairSink(sink);
+  if (pair) {
+    LoopbackPeerLink::connect(primaryLink, secondaryLink);
+    primaryLink.setDropEvery(peerDrop);
+    simulator.setPeer(&primaryLink, PEER_ROLE_PRIMARY, 0);
+    secondary.setPeer(&secondaryLink, PEER_ROLE_SECONDARY, 0);
+    simulator.setSink(&pairSink.left());
+    secondary.setSink(&pairSink.right());
+    simulator.pairWith(&secondary);
+  }
+
+  auto started = std::chrono::steady_clock::now();
+  if (replayPath) {
+    runReplay(simulator, replay, speed, tailMs);
+  } else {
+    runScript(simulator, pair ? &secondary : nullptr, script);
+    if (script != stdin) {
+      fclose(script);
+    }
+  }
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  pairSink.flush();
+  flushLogs();
+  recorder.close();
+
+  if (recordPath) {
+    std::vector<uint8_t> log(SIM_REPLAY_LOG_SIZE);
+    size_t len = simulator.replayLog().snapshot(log.data(), log.size());
+    FILE* file = fopen(recordPath, "w");
+    if (!file) {
+      fprintf(stderr, "記録ファイルを開けません: %s\n", recordPath);
+      return 1;
+    }
+    writeReplayDump(file, log.data(), len);
+    fclose(file);
+  }
+
+  const Log2Histogram& cost = simulator.frameCost();
+  fprintf(stderr, "frames=%u shown=%u dropped=%u simulated=%.3fs\n",
+          simulator.frameCount(), simulator.shownCount(), simulator.droppedCommands(),
+          hostClockUs() / 1e6);
+  if (simulator.broadcastFilter().acceptedCount() + simulator.broadcastFilter().duplicateCount() > 0) {
+    fprintf(stderr, "broadcast: accepted=%u duplicate=%u\n",
+            simulator.broadcastFilter().acceptedCount(), simulator.broadcastFilter().duplicateCount());
+  }
+  const StreamSequence& stream = simulator.streamSequence();
+  if (stream.receivedCount() + stream.staleCount() > 0) {
+    fprintf(stderr, "stream: received=%u lost=%u stale=%u last=%u\n",
+            stream.receivedCount(), stream.lostCount(), stream.staleCount(), stream.lastSeq());
+  }
+  if (pair) {
+    fprintf(stderr, "peer: sent=%u secondary shown=%u\n", primaryLink.sentCount(), secondary.shownCount());
+  }
+  const Log2Histogram& writes = simulator.writeCost();
+  fprintf(stderr, "frame cost (ns): avg=%u p99=%u max=%u\n",
+          cost.average(), cost.percentile(990), cost.max());
+  fprintf(stderr, "write cost (ns): n=%u avg=%u p99=%u max=%u\n",
+          writes.count(), writes.average(), writes.percentile(990), writes.max());
+  fprintf(stderr, "wall=%.3fs (%.0fx realtime)\n",
+          wallSeconds, wallSeconds > 0 ? (hostClockUs() / 1e6) / wallSeconds : 0.0);
+  return 0;
+}
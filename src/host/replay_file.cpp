@@ -0,0 +1,48 @@
+#include "replay_file.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "replay_log.h"
+
+void writeReplayDump(FILE* file, const uint8_t* log, size_t len) {
+  fprintf(file, "%s %zu\n", REPLAY_DUMP_BEGIN, len);
+  for (size_t i = 0; i < len; i += REPLAY_DUMP_LINE_BYTES) {
+    size_t end = i + REPLAY_DUMP_LINE_BYTES < len ? i + REPLAY_DUMP_LINE_BYTES : len;
+    for (size_t j = i; j < end; j++) {
+      fprintf(file, "%02x", log[j]);
+    }
+    fputc('\n', file);
+  }
+  fprintf(file, "%s\n", REPLAY_DUMP_END);
+}
+
+bool readReplayDump(FILE* file, std::vector<uint8_t>& log) {
+  char line[256];
+  bool inside = false;
+  log.clear();
+  while (fgets(line, sizeof(line), file)) {
+    line[strcspn(line, "\r\n")] = '\0';
+    if (!inside) {
+      inside = strncmp(line, REPLAY_DUMP_BEGIN, strlen(REPLAY_DUMP_BEGIN)) == 0;
+      continue;
+    }
+    if (strncmp(line, REPLAY_DUMP_END, strlen(REPLAY_DUMP_END)) == 0) {
+      return true;
+    }
+    size_t len = strlen(line);
+    if (len % 2 != 0) {
+      return false;
+    }
+    for (size_t i = 0; i < len; i += 2) {
+      char pair[3] = { line[i], line[i + 1], '\0' };
+      char* end;
+      long value = strtol(pair, &end, 16);
+      if (*end != '\0') {
+        return false;
+      }
+      log.push_back((uint8_t)value);
+    }
+  }
+  return false;
+}
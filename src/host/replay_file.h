@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+// リプレイログのテキスト形式（REPLAY BEGIN 〜 REPLAY END の16進の行）の読み書き
+// 実機がシリアルに出すものと同じ形式なので、シリアルモニタの出力をそのまま読める
+
+// log を書き出す
+void writeReplayDump(FILE* file, const uint8_t* log, size_t len);
+
+// 最初の REPLAY BEGIN 〜 REPLAY END の間を読み取る（前後の行は無視）
+// 見つからないか16進が不正なら false
+bool readReplayDump(FILE* file, std::vector<uint8_t>& log);
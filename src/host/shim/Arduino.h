@@ -0,0 +1,35 @@
+#pragma once
+
+// ネイティブ（ホスト）ビルド用の Arduino の代用品（時計だけ）
+//
+// 時計は仮想時計で、delay() や hostAdvanceMicros() でしか進まない。
+// シミュレータは実時間を待たずにフレームを進められ、結果も実行速度に左右されない。
+
+#include <stdint.h>
+
+// 起動からの仮想時刻（マイクロ秒）
+inline uint64_t& hostClockUs() {
+  static uint64_t now = 0;
+  return now;
+}
+
+inline void hostAdvanceMicros(uint64_t us) {
+  hostClockUs() += us;
+}
+
+// 実機と同じく uint32_t で一周する
+inline uint32_t micros() {
+  return (uint32_t)hostClockUs();
+}
+
+inline uint32_t millis() {
+  return (uint32_t)(hostClockUs() / 1000);
+}
+
+inline void delay(uint32_t ms) {
+  hostAdvanceMicros((uint64_t)ms * 1000);
+}
+
+inline void delayMicroseconds(uint32_t us) {
+  hostAdvanceMicros(us);
+}
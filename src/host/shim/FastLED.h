@@ -0,0 +1,110 @@
+#pragma once
+
+// ネイティブ（ホスト）ビルド用の FastLED の代用品
+//
+// lib/sirius_core が使う CRGB・CHSV・fill_solid だけを用意する。
+// CHSV → CRGB は FastLED の hsv2rgb_rainbow と同じ手順で変換する。
+
+#include <stddef.h>
+#include <stdint.h>
+
+inline uint8_t scale8(uint8_t i, uint8_t scale) {
+  return (uint8_t)(((uint16_t)i * (1 + (uint16_t)scale)) >> 8);
+}
+
+inline uint8_t scale8_video(uint8_t i, uint8_t scale) {
+  return (uint8_t)((((uint16_t)i * scale) >> 8) + ((i && scale) ? 1 : 0));
+}
+
+struct CHSV {
+  uint8_t hue;
+  uint8_t sat;
+  uint8_t val;
+
+  CHSV() = default;
+  constexpr CHSV(uint8_t h, uint8_t s, uint8_t v) : hue(h), sat(s), val(v) {}
+};
+
+struct CRGB {
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+
+  enum HTMLColorCode : uint32_t {
+    Black = 0x000000,
+    White = 0xFFFFFF,
+    Red   = 0xFF0000,
+    Green = 0x008000,
+    Blue  = 0x0000FF,
+  };
+
+  CRGB() = default;
+  constexpr CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+  constexpr CRGB(HTMLColorCode code)
+    : r((uint8_t)(code >> 16)), g((uint8_t)(code >> 8)), b((uint8_t)code) {}
+  CRGB(const CHSV& hsv);
+
+  bool operator==(const CRGB& other) const { return r == other.r && g == other.g && b == other.b; }
+  bool operator!=(const CRGB& other) const { return !(*this == other); }
+};
+
+static_assert(sizeof(CRGB) == 3, "CRGB must be packed like FastLED's");
+
+inline void hsv2rgb_rainbow(const CHSV& hsv, CRGB& rgb) {
+  const uint8_t hue = hsv.hue;
+  const uint8_t offset8 = (uint8_t)((hue & 0x1F) << 3);
+  const uint8_t third = scale8(offset8, 256 / 3);
+  const uint8_t twothirds = scale8(offset8, (256 * 2) / 3);
+  uint8_t r, g, b;
+
+  switch (hue >> 5) {
+    case 0: r = 255 - third; g = third;       b = 0;           break; // 赤 → 橙
+    case 1: r = 171;         g = 85 + third;  b = 0;           break; // 橙 → 黄
+    case 2: r = 171 - twothirds; g = 170 + third; b = 0;       break; // 黄 → 緑
+    case 3: r = 0;           g = 255 - third; b = third;       break; // 緑 → 水
+    case 4: r = 0;           g = 171 - twothirds; b = 85 + twothirds; break; // 水 → 青
+    case 5: r = third;       g = 0;           b = 255 - third; break; // 青 → 紫
+    case 6: r = 85 + third;  g = 0;           b = 171 - third; break; // 紫 → 桃
+    default: r = 170 + third; g = 0;          b = 85 - third;  break; // 桃 → 赤
+  }
+
+  if (hsv.sat != 255) {
+    if (hsv.sat == 0) {
+      r = g = b = 255;
+    } else {
+      uint8_t desat = 255 - hsv.sat;
+      desat = scale8_video(desat, desat);
+      uint8_t satscale = 255 - desat;
+      r = r ? scale8(r, satscale) + desat : desat;
+      g = g ? scale8(g, satscale) + desat : desat;
+      b = b ? scale8(b, satscale) + desat : desat;
+    }
+  }
+
+  if (hsv.val != 255) {
+    uint8_t val = scale8_video(hsv.val, hsv.val);
+    if (val == 0) {
+      r = g = b = 0;
+    } else {
+      r = r ? scale8(r, val) : 0;
+      g = g ? scale8(g, val) : 0;
+      b = b ? scale8(b, val) : 0;
+    }
+  }
+
+  rgb = CRGB(r, g, b);
+}
+
+inline CRGB::CRGB(const CHSV& hsv) {
+  hsv2rgb_rainbow(hsv, *this);
+}
+
+inline void fill_solid(CRGB* leds, int count, const CRGB& color) {
+  for (int i = 0; i < count; i++) {
+    leds[i] = color;
+  }
+}
+
+inline void fill_solid(CRGB* leds, int count, const CHSV& color) {
+  fill_solid(leds, count, CRGB(color));
+}
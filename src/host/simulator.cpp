@@ -0,0 +1,116 @@
+#include "simulator.h"
+
+#include <Arduino.h>
+#include <chrono>
+
+Simulator::Simulator(uint32_t fps, uint8_t deviceId) : deviceId_(deviceId) {
+  characteristic_.setCallbacks(this);
+  streamCharacteristic_.setCallbacks(this);
+  engine_.setFixedFps(fps);
+  nextFrameUs_ = hostClockUs();
+}
+
+void Simulator::setPeer(PeerLink* link, PeerRole role, uint8_t group) {
+  engine_.setPeer(link, role, group);
+}
+
+void Simulator::write(const uint8_t* data, size_t len) {
+  characteristic_.write(data, len);
+}
+
+ParseResult Simulator::broadcast(const uint8_t* data, size_t len) {
+  BroadcastPacket packet;
+  ParseResult result = parseBroadcast(data, len, packet);
+  if (result == PARSE_OK && broadcastFilter_.accept(packet, deviceId_, millis())) {
+    receiveBroadcast(packet.write, packet.writeLen);
+  }
+  return result;
+}
+
+void Simulator::streamWrite(const uint8_t* data, size_t len) {
+  streamCharacteristic_.write(data, len);
+}
+
+void Simulator::onWrite(FakeCharacteristic* characteristic) {
+  if (characteristic == &streamCharacteristic_) {
+    // 実機の MyStreamCallbacks と同じく、SEQ を確かめてから受け取る
+    StreamWrite stream;
+    if (parseStreamWrite(characteristic->getData(), characteristic->getLength(), stream) == PARSE_OK &&
+        streamSequence_.accept(stream.seq)) {
+      receive(stream.write, stream.writeLen);
+    }
+    return;
+  }
+  receive(characteristic->getData(), characteristic->getLength());
+}
+
+void Simulator::receive(const uint8_t* data, size_t len) {
+  auto started = std::chrono::steady_clock::now();
+  replayLog_.record(micros(), data, len);
+  engine_.receiveHostWrite(data, len, micros(), millis());
+  auto elapsed = std::chrono::steady_clock::now() - started;
+  writeCost_.record((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+void Simulator::receiveBroadcast(const uint8_t* data, size_t len) {
+  auto started = std::chrono::steady_clock::now();
+  replayLog_.record(micros(), data, len);
+  engine_.receiveBroadcast(data, len, micros());
+  auto elapsed = std::chrono::steady_clock::now() - started;
+  writeCost_.record((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+void Simulator::sendTimeReply(const Command& cmd) {
+  // 実機と同じ応答を通知する（仮想時計なので受信からの遅れは書き込みからの経過だけ）
+  uint32_t txTime = millis();
+  uint32_t rxTime = txTime - (micros() - cmd.arrivalUs) / 1000;
+  uint8_t reply[TIME_REPLY_LENGTH];
+  encodeTimeReply(reply, cmd.time, rxTime, txTime);
+  characteristic_.setValue(reply, sizeof(reply));
+  characteristic_.notify();
+}
+
+void Simulator::runUntil(uint64_t untilUs) {
+  while (true) {
+    // 締め切りの早い方の耳から進める（同じ時刻ならプライマリが先）
+    Simulator* next = this;
+    if (paired_ && paired_->nextFrameUs_ < nextFrameUs_) {
+      next = paired_;
+    }
+    if (next->nextFrameUs_ > untilUs) {
+      break;
+    }
+    if (hostClockUs() < next->nextFrameUs_) {
+      hostClockUs() = next->nextFrameUs_;
+    }
+    next->runFrame();
+  }
+  if (hostClockUs() < untilUs) {
+    hostClockUs() = untilUs;
+  }
+}
+
+void Simulator::runFrames(uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    runUntil(nextFrameUs_);
+  }
+}
+
+void Simulator::runFrame() {
+  uint64_t frameStartUs = hostClockUs();
+  auto started = std::chrono::steady_clock::now();
+
+  engine_.runFrame(*this);
+
+  auto elapsed = std::chrono::steady_clock::now() - started;
+  frameCost_.record((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  frameCount_++;
+
+  if (sink_) {
+    sink_->onFrame(frameStartUs, engine_.leds().pixels(), SimStrip::SIZE);
+  }
+
+  // 実機の waitForNextFrame() と同じ締め切り（仮想時計は処理中に進まない）
+  uint32_t deadline = engine_.finishFrame(micros());
+  nextFrameUs_ = hostClockUs() + (uint32_t)(deadline - micros());
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <Arduino.h>
+#include <FastLED.h>
+
+#include "broadcast.h"
+#include "device_profile.h"
+#include "fake_characteristic.h"
+#include "frame_engine.h"
+#include "led_strip.h"
+#include "peer_link.h"
+#include "led_controller.h"
+#include "protocol.h"
+#include "replay_log.h"
+#include "stats.h"
+#include "stream.h"
+#include "xy_map.h"
+
+// シミュレータのLEDテープ（実機の耳と同じ並び・明るさ、device_profile.h）
+using SimDevice = DeviceProfile<1>;
+using SimStrip = LedStrip<SimDevice::Layout>;
+using SimMap = XyMap<SimDevice::Layout, SimDevice::WIRING>;
+// シミュレータのリプレイログ（実機より大きくしてセッション全体を残す）
+#define SIM_REPLAY_LOG_SIZE (1u << 20)
+
+// 描画したフレームの受け取り先
+class FrameSink {
+public:
+  virtual ~FrameSink() = default;
+  // timeUs はフレームの開始時刻（仮想時計）
+  virtual void onFrame(uint64_t timeUs, const CRGB* leds, size_t count) = 0;
+};
+
+// 実機の loop() を仮想時計で回すシミュレータ
+//
+// BLEの書き込みは FakeCharacteristic に渡し、実機と同じ FrameEngine で
+// キューに積む。フレームの中身も実機の loop() と同じ FrameEngine::runFrame()
+// （コマンドの反映 → 予約 → 色の計算 → 描画 → 変化の判定）で処理し、
+// 次のフレームは FrameScheduler の締め切り（モードごとの目標fps）で始める。
+class Simulator : private FakeCharacteristicCallbacks, private FramePlatform {
+public:
+  // fps が 0 なら実機と同じモードごとの目標fps、それ以外はその値に固定する
+  // deviceId は配信（broadcast.h）の宛先の判定に使う
+  Simulator(uint32_t fps, uint8_t deviceId);
+
+  // BLEからの書き込み（次のフレームの先頭で反映される）
+  void write(const uint8_t* data, size_t len);
+  // ストリーム用キャラクタリスティックへの書き込み（先頭2バイトが SEQ、stream.h）
+  void streamWrite(const uint8_t* data, size_t len);
+  // アドバタイズで配信されたメーカー固有データ（宛先と SEQ を実機と同じく判定する）
+  ParseResult broadcast(const uint8_t* data, size_t len);
+
+  // 仮想時刻 untilUs までフレームを進める
+  void runUntil(uint64_t untilUs);
+  // 次のフレームから count フレーム進める
+  void runFrames(uint32_t count);
+
+  void setSink(FrameSink* sink) { sink_ = sink; }
+
+  // 耳どうしの中継（peer_link.h）の役割と通信路
+  void setPeer(PeerLink* link, PeerRole role, uint8_t group);
+  // secondary のフレームもこのシミュレータの時計で進める（左右の耳を1プロセスで動かす）
+  // それぞれの締め切りの早い方から進め、同じ時刻ならこちらが先
+  void pairWith(Simulator* secondary) { paired_ = secondary; }
+
+  const CRGB* leds() const { return engine_.leds().pixels(); }
+  const LedController& controller() const { return engine_.controller(); }
+  const CommandScheduler<SCHEDULED_COMMAND_MAX>& scheduler() const { return engine_.scheduler(); }
+  FakeCharacteristic& characteristic() { return characteristic_; }
+
+  // 進めたフレーム数・LEDへ送ったフレーム数（ShowGate を通ったもの）
+  uint32_t frameCount() const { return frameCount_; }
+  uint32_t shownCount() const { return engine_.showGate().shownCount(); }
+  uint32_t droppedCommands() const { return engine_.commandQueue().droppedCount(); }
+  const BroadcastFilter& broadcastFilter() const { return broadcastFilter_; }
+  const StreamSequence& streamSequence() const { return streamSequence_; }
+  // 1フレームの処理・1回の書き込みの受信にかかったホストの実時間（ナノ秒）
+  const Log2Histogram& frameCost() const { return frameCost_; }
+  const Log2Histogram& writeCost() const { return writeCost_; }
+
+  // 受信した書き込みの記録
+  const ReplayLog<SIM_REPLAY_LOG_SIZE>& replayLog() const { return replayLog_; }
+
+private:
+  void onWrite(FakeCharacteristic* characteristic) override;
+  void receive(const uint8_t* data, size_t len);
+  void receiveBroadcast(const uint8_t* data, size_t len);
+  void runFrame();
+
+  // FramePlatform（時計は仮想時計、LEDへの送信は FrameSink が受け取る）
+  uint32_t nowMs() override { return millis(); }
+  uint32_t nowUs() override { return micros(); }
+  uint8_t brightness() override { return SimDevice::BRIGHTNESS; }
+  void show() override {}
+  void sendStatsReport(uint8_t, uint8_t) override {} // 統計はシミュレータの終了時に出す
+  void sendTimeReply(const Command& cmd) override;
+
+  FrameEngine<SimStrip, SimMap> engine_;
+  Simulator* paired_ = nullptr;
+  uint64_t nextFrameUs_ = 0;
+  FakeCharacteristic characteristic_;
+  FakeCharacteristic streamCharacteristic_;
+  StreamSequence streamSequence_;
+  uint8_t deviceId_;
+  BroadcastFilter broadcastFilter_;
+  FrameSink* sink_ = nullptr;
+  uint32_t frameCount_ = 0;
+  Log2Histogram frameCost_;
+  Log2Histogram writeCost_;
+  ReplayLog<SIM_REPLAY_LOG_SIZE> replayLog_;
+};
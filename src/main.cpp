@@ -4,159 +4,332 @@
 #include <BLEServer.h>
 #include <BLEUtils.h>
 #include <BLE2902.h>
+#include <BLEScan.h>
+#include <BLEAdvertisedDevice.h>
+#include <esp_cpu.h>
 
-// 各基板で変更するデバイスID（基板1には1、基板2には2を設定）
-#define DEVICE_ID 1
+#include "broadcast.h"
+#include "device_config.h"
+#include "espnow_peer_link.h"
+#include "frame_engine.h"
+#include "frame_profiler.h"
+#include "log.h"
+#include "peer_link.h"
+#include "stats.h"
+#include "stream.h"
+#include "protocol.h"
+#include "replay_log.h"
 
-// デバイス固有の設定
-#if DEVICE_ID == 1
-  #define DEVICE_NAME "Sirius3_LEFT_EAR"
-  // 基板1固有の他の設定があれば追加
-#elif DEVICE_ID == 2
-  #define DEVICE_NAME "Sirius3_RIGHT_EAR"
-  // 基板2固有の他の設定があれば追加
-#else
-  #error "DEVICE_ID must be set to 1 or 2"
+// デバイスID（platformio.ini の環境ごとに build_flags で設定、基板1は1、基板2は2）
+#ifndef DEVICE_ID
+#define DEVICE_ID 1
 #endif
 
-// LEDの設定
-#define LED_PIN     D10      // データピン
-#define NUM_LEDS    int(4*12)     // LEDの数
-#define LED_TYPE    WS2812B  // LEDの種類
-#define COLOR_ORDER GRB    // カラー順序
-#define BRIGHTNESS  255    // 明るさ (0-255)
+// デバイス固有の設定（LEDの数・並び・チップ・ピンは device_config.h）
+using Device = DeviceConfig<DEVICE_ID>;
+using Strip = Device::Strip::Strip;
 
 // BLE設定
 #define SERVICE_UUID        "4fafc201-1fb5-459e-8fcc-c5c9c331914b"
 #define CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b26a8"
+#define STATS_CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b26a9" // 統計レポート（読み出し/通知）
+#define STREAM_CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b26aa" // ストリーム（応答なし書き込み、stream.h）
 
-// 色遷移のデフォルト時間（ミリ秒）
-#define DEFAULT_TRANSITION_TIME 1000
+// 統計レポートの最大長
+#define STATS_REPORT_MAX 160
 
-// 色設定モードの定義
-enum ColorMode {
-  MODE_AUTO,      // 自動色相変化モード
-  MODE_FIXED,     // 固定色モード（C:コマンド）
-  MODE_TRANSITION // 遷移モード（T:コマンド）
-};
+// 接続時に受け入れるATT MTU（バイト）。ホストがMTUの交換を要求したときにこの値まで広げる
+// 1回の書き込みに複数のコマンドを入れられるよう、BLEの上限（517）にする
+#define BLE_LOCAL_MTU 517
 
-// LEDアレイの定義
-CRGB leds[NUM_LEDS];
+// アドバタイズで配信されたコマンドを受け付けるか（build_flags で 0 にすると無効）
+#ifndef SIRIUS_BROADCAST_LISTEN
+#define SIRIUS_BROADCAST_LISTEN 1
+#endif
+// 配信を受けるスキャンの間隔と窓（ミリ秒）。残りの時間を接続とアドバタイズに回す
+#define BROADCAST_SCAN_INTERVAL_MS 100
+#define BROADCAST_SCAN_WINDOW_MS 30
+
+// 耳どうしの中継（build_flags で 1 にすると DeviceConfig の PEER_ROLE で動く）
+// ホストはプライマリにだけ接続し、セカンダリへは ESP-NOW で転送する
+#ifndef SIRIUS_PEER_RELAY
+#define SIRIUS_PEER_RELAY 0
+#endif
+// 組になる耳の番号（近くの別の組と区別する）
+#ifndef SIRIUS_PEER_GROUP
+#define SIRIUS_PEER_GROUP 0
+#endif
+#define PEER_LINK_CHANNEL 1
+
+// 受信した書き込みを記録するリプレイログの大きさ（バイト、2のべき乗）
+#define REPLAY_LOG_SIZE 8192
+
+// LED・コマンドの受信と反映・フレーム周期（シミュレータと共通、frame_engine.h）
+FrameEngine<Strip, Device::Strip::Map> engine;
 
 // グローバル変数
-uint8_t gHue = 0; // 色相の変化用
-bool autoHueChange = true; // 自動色相変化モード
 bool deviceConnected = false;
 bool oldDeviceConnected = false;
-CRGB currentColor = CRGB::White; // 初期色は白
-ColorMode colorMode = MODE_AUTO; // 初期モードは自動色相変化
 
-// 色遷移関連の変数
-bool isTransitioning = false; // 色遷移中かどうか
-CRGB startColor;             // 遷移開始色
-CRGB targetColor;            // 遷移目標色
-unsigned long transitionStartTime = 0; // 遷移開始時刻
-unsigned long transitionDuration = DEFAULT_TRANSITION_TIME; // 遷移時間
+// ストリームの SEQ の抜け・遅れ（BLEのタスクで更新し、loop() は統計レポートで読むだけ）
+StreamSequence streamSequence;
+
+#if SIRIUS_PEER_RELAY
+// 耳どうしの中継
+EspNowPeerLink peerLink;
+#endif
+// 受信した書き込みの記録（シリアルの 'r' で出力し、シミュレータで再生する）
+ReplayLog<REPLAY_LOG_SIZE> replayLog;
 
 BLEServer* pServer = NULL;
 BLECharacteristic* pCharacteristic = NULL;
+BLECharacteristic* pStatsCharacteristic = NULL;
+BLECharacteristic* pStreamCharacteristic = NULL;
+
+// loop() の区間別の所要時間（CPUサイクル）
+FrameProfiler profiler;
+
+inline uint32_t profileNow() {
+  return esp_cpu_get_cycle_count();
+}
 
 // BLE接続状態のコールバッククラス
 class MyServerCallbacks: public BLEServerCallbacks {
     void onConnect(BLEServer* pServer) {
       deviceConnected = true;
-      Serial.println("デバイスが接続されました");
+      streamSequence.reset(); // ホストは接続ごとに SEQ を数え直す
+      // MTUの交換はクライアント（ホスト）からしか要求できないので、サーバーは setup() で
+      // BLE_LOCAL_MTU を受け入れる値にしておき、ホストの交換要求に応じる（onMtuChanged）
+      LOG_INFO("デバイスが接続されました");
+    }
+
+    void onMtuChanged(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
+      LOG_INFO("MTUを交換しました: %dバイト（1回の書き込みは最大%dバイト）", param->mtu.mtu, param->mtu.mtu - 3);
     }
 
     void onDisconnect(BLEServer* pServer) {
       deviceConnected = false;
-      Serial.println("デバイスが切断されました");
+      LOG_INFO("デバイスが切断されました");
+    }
+};
+
+// 区間別の所要時間をシリアルに出力する（マイクロ秒）
+// 区間の番号は ProfileStage の順（0:drain 1:effect 2:compose 3:show 4:log 5:idle）
+void dumpProfile() {
+  uint32_t mhz = getCpuFrequencyMhz();
+  for (uint8_t i = 0; i < PROFILE_STAGE_COUNT; i++) {
+    const Log2Histogram& h = profiler.stage((ProfileStage)i);
+    LOG_INFO("profile %d: n=%u avg=%u p99=%u max=%u",
+             i, h.count(), h.average() / mhz, h.percentile(990) / mhz, h.max() / mhz);
+  }
+  const Log2Histogram& f = profiler.frame();
+  LOG_INFO("profile frame: n=%u avg=%u p99=%u max=%u",
+           f.count(), f.average() / mhz, f.percentile(990) / mhz, f.max() / mhz);
+}
+
+// リプレイログをシリアルに16進で出力する（REPLAY BEGIN 〜 REPLAY END）
+// 要求されたときだけなので、遅延ログを通さずにその場で書き出す
+void dumpReplayLog() {
+  static uint8_t snapshot[REPLAY_LOG_SIZE];
+  size_t len = replayLog.snapshot(snapshot, sizeof(snapshot));
+  if (len == 0 && replayLog.recordedCount() > 0) {
+    LOG_WARN("リプレイログを取り出せませんでした（受信中）");
+    return;
+  }
+
+  char hex[REPLAY_DUMP_LINE_BYTES * 2 + 1];
+  Serial.printf("%s %u\n", REPLAY_DUMP_BEGIN, (unsigned)len);
+  for (size_t i = 0; i < len; i += REPLAY_DUMP_LINE_BYTES) {
+    size_t n = 0;
+    for (size_t j = i; j < len && j < i + REPLAY_DUMP_LINE_BYTES; j++) {
+      n += snprintf(&hex[n], sizeof(hex) - n, "%02x", snapshot[j]);
     }
+    Serial.println(hex);
+  }
+  Serial.println(REPLAY_DUMP_END);
+}
+
+// 統計レポートを統計キャラクタリスティックに書き込んで通知する
+// 通知はMTUで切り詰められるので、ホストは通知を合図に読み出して全体を取得する
+void sendStatsReport(uint8_t report, uint8_t flags) {
+  uint8_t buffer[STATS_REPORT_MAX];
+  StatsWriter writer(buffer, sizeof(buffer));
+
+  writer.putU8(report);
+  writer.putU8(1); // レポートの版
+  switch (report) {
+    case STATS_REPORT_LATENCY:
+      writer.putSummary(engine.latencyQueue());
+      writer.putSummary(engine.latencyShow());
+      writer.putSummary(engine.latencyTotal());
+      writer.putU32(engine.commandQueue().pushedCount());
+      writer.putU32(engine.commandQueue().droppedCount());
+      writer.putU32(engine.showGate().shownCount());
+      writer.putU32(engine.showGate().skippedCount());
+      writer.putU32(engine.frameScheduler().overrunCount());
+      writer.putU32(engine.frameScheduler().maxOverrun());
+      writer.putU32(logDroppedCount());
+      if (flags & STATS_FLAG_RESET) {
+        engine.resetLatency();
+      }
+      break;
+
+    case STATS_REPORT_PROFILE:
+      // 値はCPUサイクル。ホストはCPU周波数で割ってマイクロ秒にする
+      writer.putU16(getCpuFrequencyMhz());
+      writer.putU16(engine.frameScheduler().period()); // フレームの予算（マイクロ秒）
+      for (uint8_t i = 0; i < PROFILE_STAGE_COUNT; i++) {
+        writer.putSummary(profiler.stage((ProfileStage)i));
+      }
+      writer.putSummary(profiler.frame());
+      if (flags & STATS_FLAG_SERIAL) {
+        dumpProfile();
+      }
+      if (flags & STATS_FLAG_RESET) {
+        profiler.reset();
+      }
+      break;
+
+    case STATS_REPORT_STREAM:
+      // 接続してからの累計（STATS_FLAG_RESET は使わない。ホストは前回との差を取る）
+      writer.putU32(streamSequence.receivedCount());
+      writer.putU32(streamSequence.lostCount());
+      writer.putU32(streamSequence.staleCount());
+      writer.putU16(streamSequence.lastSeq());
+      break;
+
+    default:
+      LOG_WARN("未知の統計レポート: %d", report);
+      return;
+  }
+
+  pStatsCharacteristic->setValue(buffer, writer.length());
+  if (deviceConnected) {
+    pStatsCharacteristic->notify();
+  }
+}
+
+// 時刻同期の問い合わせに応答する（受信時刻と応答時刻を通知する）
+void sendTimeReply(const Command& cmd) {
+  uint32_t txTime = millis();
+  uint32_t rxTime = txTime - (micros() - cmd.arrivalUs) / 1000;
+  uint8_t reply[TIME_REPLY_LENGTH];
+  encodeTimeReply(reply, cmd.time, rxTime, txTime);
+  pCharacteristic->setValue(reply, sizeof(reply));
+  if (deviceConnected) {
+    pCharacteristic->notify();
+  }
+}
+
+// FrameEngine に渡す実機の部分（時計・FastLED・BLEの通知・区間の計測）
+class DevicePlatform : public FramePlatform {
+public:
+  uint32_t nowMs() override { return millis(); }
+  uint32_t nowUs() override { return micros(); }
+  uint8_t brightness() override { return FastLED.getBrightness(); }
+  void show() override { FastLED.show(); }
+  void sendStatsReport(uint8_t report, uint8_t flags) override { ::sendStatsReport(report, flags); }
+  void sendTimeReply(const Command& cmd) override { ::sendTimeReply(cmd); }
+  void mark(ProfileStage stage) override { profiler.mark(stage, profileNow()); }
 };
+DevicePlatform platform;
+
+// ホストからの1回の書き込みを受け取る（制御用・ストリームのコールバックから呼ぶ）
+void receiveHostWrite(const uint8_t* data, size_t len, uint32_t arrivalUs) {
+  LOG_DEBUG("受信データ: %dバイト", len);
+  replayLog.record(arrivalUs, data, len);
+  engine.receiveHostWrite(data, len, arrivalUs, millis());
+}
 
 // BLEからのデータ受信コールバッククラス
 class MyCallbacks: public BLECharacteristicCallbacks {
     void onWrite(BLECharacteristic *pCharacteristic) {
-      String arduinoValue = pCharacteristic->getValue();
-      std::string value(arduinoValue.c_str(), arduinoValue.length());
-      if (value.length() > 0) {
-        Serial.print("受信データ: ");
-        Serial.println(value.c_str());
-        
-        // コマンドの処理
-        if (value[0] == 'C' && value[1] == ':') {
-          // RGB値で色を設定（例: C:255,0,0）
-          int r, g, b;
-          sscanf(value.c_str(), "C:%d,%d,%d", &r, &g, &b);
-          currentColor = CRGB(r, g, b);
-          autoHueChange = false;
-          isTransitioning = false; // 即時変更なので遷移をキャンセル
-          colorMode = MODE_FIXED;  // 固定色モードに設定
-          Serial.printf("色を設定: R=%d, G=%d, B=%d\n", r, g, b);
-        } 
-        else if (value[0] == 'H' && value[1] == ':') {
-          // 色相値を設定（例: H:128）
-          int hue;
-          sscanf(value.c_str(), "H:%d", &hue);
-          gHue = hue;
-          autoHueChange = false;
-          isTransitioning = false; // 即時変更なので遷移をキャンセル
-          colorMode = MODE_FIXED;  // 固定色モードに設定（H:は固定色の一種）
-          Serial.printf("色相を設定: %d\n", hue);
-        }
-        else if (value[0] == 'M' && value[1] == ':') {
-          // モード切替（例: M:1で自動色相変化、M:0で固定色）
-          int mode;
-          sscanf(value.c_str(), "M:%d", &mode);
-          autoHueChange = (mode == 1);
-          isTransitioning = false; // モード変更時は遷移をキャンセル
-          colorMode = autoHueChange ? MODE_AUTO : MODE_FIXED;  // 自動モードと固定モードを切り替え
-          Serial.printf("モードを設定: %s\n", autoHueChange ? "自動色相変化" : "固定色");
-        }
-        else if (value[0] == 'T' && value[1] == ':') {
-          // 色遷移コマンド（例: T:255,0,0,2000）
-          // T:R,G,B,TIME で、現在の色から指定色に TIME ミリ秒かけて遷移
-          int r, g, b, time = DEFAULT_TRANSITION_TIME;
-          int parsed = sscanf(value.c_str(), "T:%d,%d,%d,%d", &r, &g, &b, &time);
-          
-          // 必須のRGB値が解析できたか確認
-          if (parsed >= 3) {
-            // 遷移パラメータを設定 - 常に現在の色から開始（遷移中でも）
-            startColor = currentColor; // 現在の色を開始色に（遷移中の色も含む）
-            targetColor = CRGB(r, g, b); // 目標色を設定
-            transitionDuration = (parsed == 4) ? time : DEFAULT_TRANSITION_TIME; // 時間が省略されていればデフォルト値を使用
-            transitionStartTime = millis(); // 現在時刻を記録
-            isTransitioning = true; // 遷移モードを有効に
-            autoHueChange = false; // 自動色相変化を無効に
-            colorMode = MODE_TRANSITION;  // 遷移モードに設定
-            
-            if (startColor.r == targetColor.r && startColor.g == targetColor.g && startColor.b == targetColor.b) {
-              // 開始色と目標色が同じ場合は遷移不要
-              isTransitioning = false;
-              Serial.println("開始色と目標色が同じため、遷移はスキップされます");
-            } else {
-              Serial.printf("色遷移開始: 現在色(R=%d,G=%d,B=%d)から目標色(R=%d,G=%d,B=%d)へ %dミリ秒で遷移\n", 
-                         startColor.r, startColor.g, startColor.b,
-                         targetColor.r, targetColor.g, targetColor.b,
-                         transitionDuration);
-            }
-          }
-        }
+      uint32_t arrivalUs = micros(); // 遅延計測用の受信時刻
+      // 受信データはキャラクタリスティックの値を直接読む（String へのコピーを作らない）
+      const uint8_t* data = pCharacteristic->getData();
+      size_t len = pCharacteristic->getLength();
+      if (len > 0) {
+        receiveHostWrite(data, len, arrivalUs);
       }
     }
 };
 
+// ストリーム（応答なし書き込み）の受信コールバッククラス
+// 制御用と同じBLEのタスクから呼ばれる。SEQ を確かめてから同じ経路でキューに積む
+class MyStreamCallbacks: public BLECharacteristicCallbacks {
+    void onWrite(BLECharacteristic *pCharacteristic) {
+      uint32_t arrivalUs = micros();
+      StreamWrite stream;
+      ParseResult result = parseStreamWrite(pCharacteristic->getData(), pCharacteristic->getLength(), stream);
+      if (result != PARSE_OK) {
+        LOG_WARN("ストリームの書き込みが不正です: %d", result);
+        return;
+      }
+      if (!streamSequence.accept(stream.seq)) {
+        return; // 遅れて届いた古い書き込み
+      }
+      receiveHostWrite(stream.write, stream.writeLen, arrivalUs);
+    }
+};
+
+#if SIRIUS_BROADCAST_LISTEN
+// 配信の重複除去（同じ SEQ のアドバタイズは何度も届く）
+BroadcastFilter broadcastFilter;
+
+// アドバタイズで配信されたコマンドの受信コールバッククラス
+// onWrite と同じBLEのタスクから呼ばれるので、同じ経路でキューに積む
+class MyBroadcastCallbacks: public BLEAdvertisedDeviceCallbacks {
+    void onResult(BLEAdvertisedDevice advertisedDevice) {
+      if (!advertisedDevice.haveManufacturerData()) {
+        return;
+      }
+      auto manufacturerData = advertisedDevice.getManufacturerData();
+      BroadcastPacket packet;
+      if (parseBroadcast((const uint8_t*)manufacturerData.c_str(), manufacturerData.length(), packet) != PARSE_OK ||
+          !broadcastFilter.accept(packet, DEVICE_ID, millis())) {
+        return;
+      }
+      uint32_t arrivalUs = micros();
+      LOG_DEBUG("配信を受信: SEQ=%u %dバイト", packet.seq, packet.writeLen);
+      replayLog.record(arrivalUs, packet.write, packet.writeLen);
+      engine.receiveBroadcast(packet.write, packet.writeLen, arrivalUs);
+    }
+};
+#endif
+
+// 溜まったログをシリアルに出力する（送信バッファに空きがある分だけ）
+void flushLogs() {
+  char line[LOG_LINE_MAX];
+  uint8_t level;
+  while (Serial.availableForWrite() >= LOG_LINE_MAX && logPop(line, sizeof(line), level)) {
+    Serial.println(line);
+  }
+}
+
+// 次のフレームの開始時刻まで待つ
+// ミリ秒単位の部分はdelay()で他のタスク（BLE）に譲り、残りはmicros()で合わせる
+void waitForNextFrame() {
+  uint32_t deadline = engine.finishFrame(micros());
+  int32_t remaining = (int32_t)(deadline - micros());
+  if (remaining > 1000) {
+    delay((remaining - 1000) / 1000);
+  }
+  while ((int32_t)(deadline - micros()) > 0) {
+  }
+}
+
 void setup() {
   // FastLEDの初期化
-  FastLED.addLeds<LED_TYPE, LED_PIN, COLOR_ORDER>(leds, NUM_LEDS).setCorrection(TypicalLEDStrip);
-  FastLED.setBrightness(BRIGHTNESS);
+  Device::Strip::addLeds(engine.leds()).setCorrection(TypicalLEDStrip);
+  FastLED.setBrightness(Device::BRIGHTNESS);
   
   // デバッグ用シリアル通信の開始
   Serial.begin(115200);
-  Serial.println("RGB LEDテープ制御プログラム起動");
+  LOG_INFO("RGB LEDテープ制御プログラム起動");
 
   // BLEの初期化
-  BLEDevice::init(DEVICE_NAME);
+  BLEDevice::init(Device::NAME);
+  BLEDevice::setMTU(BLE_LOCAL_MTU); // 接続前に設定しておく（MTUの交換で使われる）
   esp_ble_tx_power_set(ESP_BLE_PWR_TYPE_DEFAULT, ESP_PWR_LVL_P9); // 出力パワーを最大(+9dBm)に設定
   esp_ble_tx_power_set(ESP_BLE_PWR_TYPE_ADV, ESP_PWR_LVL_P9);     // アドバタイジングの出力も最大に
   pServer = BLEDevice::createServer();  // ここでGATTServerを作成
@@ -173,66 +346,95 @@ void setup() {
   
   pCharacteristic->setCallbacks(new MyCallbacks());
   pCharacteristic->addDescriptor(new BLE2902());
+
+  // 統計レポート用（OP_STATS_REQUEST で更新して通知する）
+  pStatsCharacteristic = pService->createCharacteristic(
+                      STATS_CHARACTERISTIC_UUID,
+                      BLECharacteristic::PROPERTY_READ |
+                      BLECharacteristic::PROPERTY_NOTIFY
+                    );
+  pStatsCharacteristic->addDescriptor(new BLE2902());
+
+  // ストリーム用（応答を待たない書き込み。ピクセルフレームなど高い頻度のもの）
+  pStreamCharacteristic = pService->createCharacteristic(
+                      STREAM_CHARACTERISTIC_UUID,
+                      BLECharacteristic::PROPERTY_WRITE_NR
+                    );
+  pStreamCharacteristic->setCallbacks(new MyStreamCallbacks());
   
   pService->start();
   
   BLEAdvertising *pAdvertising = pServer->getAdvertising();
   pAdvertising->start();
-  Serial.println("BLEサーバーが起動しました");
+
+#if SIRIUS_BROADCAST_LISTEN
+  // 配信を受けるパッシブスキャン（同じアドバタイズも毎回コールバックに渡し、結果は溜めない）
+  BLEScan* pScan = BLEDevice::getScan();
+  pScan->setAdvertisedDeviceCallbacks(new MyBroadcastCallbacks(), true);
+  pScan->setActiveScan(false);
+  pScan->setInterval(BROADCAST_SCAN_INTERVAL_MS);
+  pScan->setWindow(BROADCAST_SCAN_WINDOW_MS);
+  pScan->start(0, nullptr, false); // 0: 止めるまでスキャンを続ける
+  LOG_INFO("配信の受信を開始");
+#endif
+  LOG_INFO("BLEサーバーが起動しました");
+
+#if SIRIUS_PEER_RELAY
+  // 耳どうしの中継（BLEと同じ無線を時分割で使う）
+  if (Device::PEER_ROLE != PEER_ROLE_NONE) {
+    if (peerLink.begin(PEER_LINK_CHANNEL)) {
+      engine.setPeer(&peerLink, Device::PEER_ROLE, SIRIUS_PEER_GROUP);
+      LOG_INFO("ピアリンクを開始: 役割=%d グループ=%d", Device::PEER_ROLE, SIRIUS_PEER_GROUP);
+    } else {
+      LOG_ERROR("ピアリンクを開始できません");
+    }
+  }
+#endif
 }
 
 void loop() {
+  profiler.beginFrame(profileNow());
+
   // BLE接続管理
   if (deviceConnected != oldDeviceConnected) {
     if (deviceConnected) {
-      Serial.println("BLE接続開始");
+      LOG_INFO("BLE接続開始");
     } else {
-      Serial.println("BLE接続終了");
+      LOG_INFO("BLE接続終了");
       delay(500); // 接続終了を安定させるため
       pServer->startAdvertising(); // 再度アドバタイズを開始
-      Serial.println("BLEアドバタイズを再開");
+      LOG_INFO("BLEアドバタイズを再開");
     }
     oldDeviceConnected = deviceConnected;
   }
 
-  // 色遷移処理
-  if (isTransitioning) {
-    unsigned long currentTime = millis();
-    unsigned long elapsedTime = currentTime - transitionStartTime;
-    
-    if (elapsedTime >= transitionDuration) {
-      // 遷移完了
-      currentColor = targetColor;
-      isTransitioning = false;
-      // ここでモードは変更しない（colorMode = MODE_TRANSITIONのまま）
-      Serial.println("色遷移完了");
-    } else {
-      // 遷移中
-      float progress = (float)elapsedTime / transitionDuration; // 0.0 から 1.0 の進行度
-      
-      // 線形補間で現在の色を計算
-      currentColor.r = startColor.r + (targetColor.r - startColor.r) * progress;
-      currentColor.g = startColor.g + (targetColor.g - startColor.g) * progress;
-      currentColor.b = startColor.b + (targetColor.b - startColor.b) * progress;
+  // 受信したコマンドの反映・色の計算・描画・LEDへの送信（区間の計測は platform.mark()）
+  engine.runFrame(platform);
+
+  // シリアルからの要求（'p': 区間別の所要時間、'r': リプレイログ）
+  if (Serial.available() > 0) {
+    switch (Serial.read()) {
+      case 'p':
+        dumpProfile();
+        break;
+      case 'r':
+        dumpReplayLog();
+        break;
+      default:
+        break;
     }
-    
-    // 遷移中の色で全LEDを設定
-    fill_solid(leds, NUM_LEDS, currentColor);
   }
-  // モードに応じたLED制御
-  else if (colorMode == MODE_AUTO) {
-    // 自動色相変化モード
-    EVERY_N_MILLISECONDS(20) { gHue++; } // 色相を緩やかに変化
-    fill_solid(leds, NUM_LEDS, CHSV(gHue, 255, 255));
-  } 
-  else if (colorMode == MODE_FIXED || colorMode == MODE_TRANSITION) {
-    // 固定色モードまたは遷移完了後（現在のcolorModeを維持）
-    // 色相による色の使用は廃止し、常に指定されたRGB値を使用する
-    fill_solid(leds, NUM_LEDS, currentColor);
+  EVERY_N_SECONDS(5) {
+    LOG_DEBUG("フレーム: 送信=%u 省略=%u 超過=%u 最大超過=%uマイクロ秒",
+              engine.showGate().shownCount(), engine.showGate().skippedCount(),
+              engine.frameScheduler().overrunCount(), engine.frameScheduler().maxOverrun());
   }
-  
-  // LEDを更新
-  FastLED.show();
-  // フレームレートの調整tLED.delay(1000/60); // 約60fps
-  FastLED.delay(1000/60); // 約60fps
+
+  // 空き時間にログを出力
+  flushLogs();
+  profiler.mark(PROFILE_LOG, profileNow());
+
+  // フレームレートの調整（モードごとの目標fpsで、次のフレームの締め切りまで待つ）
+  waitForNextFrame();
+  profiler.mark(PROFILE_IDLE, profileNow());
 }
\ No newline at end of file
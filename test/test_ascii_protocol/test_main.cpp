@@ -0,0 +1,167 @@
+// ASCII形式のコマンド（C: / H: / M: / T: / E:）の解析と範囲チェックのテスト
+//   pio test -e native -f test_ascii_protocol
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "easing.h"
+#include "effects.h"
+#include "protocol.h"
+
+void setUp() {}
+void tearDown() {}
+
+static ParseResult parse(const char* text, Command& out) {
+  return parseAsciiCommand((const uint8_t*)text, strlen(text), out);
+}
+
+void test_color_hue_and_mode() {
+  Command cmd;
+  TEST_ASSERT_EQUAL(PARSE_OK, parse("C:255,128,0", cmd));
+  TEST_ASSERT_EQUAL(CMD_COLOR, cmd.type);
+  TEST_ASSERT_EQUAL_UINT8(255, cmd.r);
+  TEST_ASSERT_EQUAL_UINT8(128, cmd.g);
+  TEST_ASSERT_EQUAL_UINT8(0, cmd.b);
+  TEST_ASSERT_FALSE(cmd.hasStartAt);
+
+  TEST_ASSERT_EQUAL(PARSE_OK, parse("H:200", cmd));
+  TEST_ASSERT_EQUAL(CMD_HUE, cmd.type);
+  TEST_ASSERT_EQUAL_UINT8(200, cmd.hue);
+
+  TEST_ASSERT_EQUAL(PARSE_OK, parse("M:1", cmd));
+  TEST_ASSERT_EQUAL(CMD_MODE, cmd.type);
+  TEST_ASSERT_EQUAL_UINT8(1, cmd.mode);
+}
+
+void test_transition_optional_fields() {
+  Command cmd;
+  TEST_ASSERT_EQUAL(PARSE_OK, parse("T:1,2,3", cmd));
+  TEST_ASSERT_EQUAL(CMD_TRANSITION, cmd.type);
+  TEST_ASSERT_FALSE(cmd.hasDuration);
+  TEST_ASSERT_EQUAL_UINT8(EASE_LINEAR, cmd.easing);
+
+  TEST_ASSERT_EQUAL(PARSE_OK, parse("T:1,2,3,2000", cmd));
+  TEST_ASSERT_TRUE(cmd.hasDuration);
+  TEST_ASSERT_EQUAL_UINT32(2000, cmd.duration);
+  TEST_ASSERT_EQUAL_UINT8(EASE_LINEAR, cmd.easing);
+
+  TEST_ASSERT_EQUAL(PARSE_OK, parse("T:1,2,3,0,4", cmd));
+  TEST_ASSERT_TRUE(cmd.hasDuration);
+  TEST_ASSERT_EQUAL_UINT32(0, cmd.duration);
+  TEST_ASSERT_EQUAL_UINT8(4, cmd.easing);
+
+  // 4294967295 は uint32_t に収まる
+  TEST_ASSERT_EQUAL(PARSE_OK, parse("T:1,2,3,4294967295", cmd));
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, cmd.duration);
+}
+
+void test_effect_fields() {
+  Command cmd;
+  TEST_ASSERT_EQUAL(PARSE_OK, parse("E:0,255,191,0,500,6,300", cmd));
+  TEST_ASSERT_EQUAL(CMD_EFFECT, cmd.type);
+  TEST_ASSERT_EQUAL_UINT8(0, cmd.effect);
+  TEST_ASSERT_EQUAL_UINT8(255, cmd.r);
+  TEST_ASSERT_EQUAL_UINT8(191, cmd.g);
+  TEST_ASSERT_EQUAL_UINT8(0, cmd.b);
+  TEST_ASSERT_EQUAL_UINT16(500, cmd.period);
+  TEST_ASSERT_EQUAL_UINT8(6, cmd.cycles);
+  TEST_ASSERT_EQUAL_UINT16(300, cmd.fade);
+
+  TEST_ASSERT_EQUAL(PARSE_OK, parse("E:0,0,0,0,65535,255,65535", cmd));
+  TEST_ASSERT_EQUAL_UINT16(0xFFFF, cmd.period);
+  TEST_ASSERT_EQUAL_UINT8(255, cmd.cycles);
+  TEST_ASSERT_EQUAL_UINT16(0xFFFF, cmd.fade);
+}
+
+// 範囲外の値は切り詰めずに PARSE_OUT_OF_RANGE
+void test_out_of_range_values() {
+  Command cmd;
+  TEST_ASSERT_EQUAL(PARSE_OUT_OF_RANGE, parse("C:256,0,0", cmd));
+  TEST_ASSERT_EQUAL(PARSE_OUT_OF_RANGE, parse("C:0,0,999", cmd));
+  TEST_ASSERT_EQUAL(PARSE_OUT_OF_RANGE, parse("H:256", cmd));
+  TEST_ASSERT_EQUAL(PARSE_OUT_OF_RANGE, parse("M:2", cmd));
+  TEST_ASSERT_EQUAL(PARSE_OUT_OF_RANGE, parse("T:0,300,0", cmd));
+
+  char text[32];
+  snprintf(text, sizeof(text), "T:0,0,0,100,%d", (int)EASING_COUNT);
+  TEST_ASSERT_EQUAL(PARSE_OUT_OF_RANGE, parse(text, cmd));
+  snprintf(text, sizeof(text), "E:%d,0,0,0,500,1,0", (int)EFFECT_TYPE_COUNT);
+  TEST_ASSERT_EQUAL(PARSE_OUT_OF_RANGE, parse(text, cmd));
+
+  TEST_ASSERT_EQUAL(PARSE_OUT_OF_RANGE, parse("E:0,256,0,0,500,1,0", cmd));
+  TEST_ASSERT_EQUAL(PARSE_OUT_OF_RANGE, parse("E:0,0,0,0,65536,1,0", cmd));
+  TEST_ASSERT_EQUAL(PARSE_OUT_OF_RANGE, parse("E:0,0,0,0,500,256,0", cmd));
+  TEST_ASSERT_EQUAL(PARSE_OUT_OF_RANGE, parse("E:0,0,0,0,500,1,65536", cmd));
+}
+
+// uint32_t を超える数値は桁あふれで別の値にならない
+void test_overflow_is_rejected() {
+  Command cmd;
+  TEST_ASSERT_EQUAL(PARSE_OUT_OF_RANGE, parse("T:1,2,3,4294967296", cmd));
+  TEST_ASSERT_EQUAL(PARSE_OUT_OF_RANGE, parse("C:4294967552,0,0", cmd));
+  TEST_ASSERT_EQUAL(PARSE_OUT_OF_RANGE, parse("H:99999999999999999999", cmd));
+}
+
+void test_whitespace_around_fields() {
+  Command cmd;
+  TEST_ASSERT_EQUAL(PARSE_OK, parse("C: 1 , 2 ,3 \r", cmd));
+  TEST_ASSERT_EQUAL_UINT8(1, cmd.r);
+  TEST_ASSERT_EQUAL_UINT8(2, cmd.g);
+  TEST_ASSERT_EQUAL_UINT8(3, cmd.b);
+
+  TEST_ASSERT_EQUAL(PARSE_OK, parse("H:\t7", cmd));
+  TEST_ASSERT_EQUAL_UINT8(7, cmd.hue);
+
+  // 数字の途中の空白は区切りにならない
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parse("H:1 2", cmd));
+}
+
+void test_invalid_format() {
+  Command cmd;
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parse("C:1,2", cmd));
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parse("C:1,2,3,4", cmd));
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parse("C:1,,3", cmd));
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parse("C:1,2,", cmd));
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parse("C:", cmd));
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parse("H:-1", cmd));
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parse("H:0x10", cmd));
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parse("M:0,1", cmd));
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parse("T:1,2", cmd));
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parse("T:1,2,3,4,5,6", cmd));
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parse("E:0,0,0,0,500,1", cmd));
+  // 8個以上のフィールドはどのコマンドでも受け付けない
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parse("E:0,0,0,0,500,1,0,0", cmd));
+}
+
+void test_unknown_and_empty() {
+  Command cmd;
+  TEST_ASSERT_EQUAL(PARSE_EMPTY, parseAsciiCommand((const uint8_t*)"", 0, cmd));
+  TEST_ASSERT_EQUAL(PARSE_UNKNOWN, parse("C", cmd));
+  TEST_ASSERT_EQUAL(PARSE_UNKNOWN, parse("C=1,2,3", cmd));
+  TEST_ASSERT_EQUAL(PARSE_UNKNOWN, parse("X:1", cmd));
+  TEST_ASSERT_EQUAL(PARSE_UNKNOWN, parse("c:1,2,3", cmd));
+}
+
+// parseCommand は先頭が PROTOCOL_MAGIC でなければ ASCII として解析する
+void test_parse_command_dispatches_ascii() {
+  Command cmd;
+  const char* text = "H:42";
+  TEST_ASSERT_EQUAL(PARSE_OK, parseCommand((const uint8_t*)text, strlen(text), cmd));
+  TEST_ASSERT_EQUAL(CMD_HUE, cmd.type);
+  TEST_ASSERT_EQUAL_UINT8(42, cmd.hue);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_color_hue_and_mode);
+  RUN_TEST(test_transition_optional_fields);
+  RUN_TEST(test_effect_fields);
+  RUN_TEST(test_out_of_range_values);
+  RUN_TEST(test_overflow_is_rejected);
+  RUN_TEST(test_whitespace_around_fields);
+  RUN_TEST(test_invalid_format);
+  RUN_TEST(test_unknown_and_empty);
+  RUN_TEST(test_parse_command_dispatches_ascii);
+  return UNITY_END();
+}
@@ -0,0 +1,211 @@
+// バイナリ形式のコマンド（protocol.h の PROTOCOL_MAGIC + オペコード）の解析のテスト
+//   pio test -e native -f test_binary_protocol
+
+#include <unity.h>
+
+#include "easing.h"
+#include "effects.h"
+#include "protocol.h"
+
+void setUp() {}
+void tearDown() {}
+
+// PROTOCOL_MAGIC の後ろの1コマンドを解析する（consumed は len と一致すること）
+static ParseResult parse(const uint8_t* data, size_t len, Command& out) {
+  size_t consumed = 0;
+  ParseResult result = parseBinaryCommand(data, len, out, consumed);
+  if (result == PARSE_OK) {
+    TEST_ASSERT_EQUAL(len, consumed);
+  } else {
+    TEST_ASSERT_EQUAL(0, consumed);
+  }
+  return result;
+}
+
+void test_color_hue_and_mode() {
+  Command cmd;
+  const uint8_t color[] = { OP_COLOR, 10, 20, 30 };
+  TEST_ASSERT_EQUAL(PARSE_OK, parse(color, sizeof(color), cmd));
+  TEST_ASSERT_EQUAL(CMD_COLOR, cmd.type);
+  TEST_ASSERT_EQUAL_UINT8(10, cmd.r);
+  TEST_ASSERT_EQUAL_UINT8(20, cmd.g);
+  TEST_ASSERT_EQUAL_UINT8(30, cmd.b);
+  TEST_ASSERT_FALSE(cmd.hasStartAt);
+
+  const uint8_t hue[] = { OP_HUE, 200 };
+  TEST_ASSERT_EQUAL(PARSE_OK, parse(hue, sizeof(hue), cmd));
+  TEST_ASSERT_EQUAL(CMD_HUE, cmd.type);
+  TEST_ASSERT_EQUAL_UINT8(200, cmd.hue);
+
+  const uint8_t mode[] = { OP_MODE, 1 };
+  TEST_ASSERT_EQUAL(PARSE_OK, parse(mode, sizeof(mode), cmd));
+  TEST_ASSERT_EQUAL(CMD_MODE, cmd.type);
+  TEST_ASSERT_EQUAL_UINT8(1, cmd.mode);
+}
+
+void test_mode_above_one_is_rejected() {
+  Command cmd;
+  const uint8_t mode[] = { OP_MODE, 2 };
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parse(mode, sizeof(mode), cmd));
+}
+
+void test_transition_reads_little_endian_duration() {
+  Command cmd;
+  const uint8_t transition[] = { OP_TRANSITION, 255, 0, 0, 0xD0, 0x07 };
+  TEST_ASSERT_EQUAL(PARSE_OK, parse(transition, sizeof(transition), cmd));
+  TEST_ASSERT_EQUAL(CMD_TRANSITION, cmd.type);
+  TEST_ASSERT_TRUE(cmd.hasDuration);
+  TEST_ASSERT_EQUAL_UINT32(2000, cmd.duration);
+  TEST_ASSERT_EQUAL_UINT8(EASE_LINEAR, cmd.easing);
+
+  const uint8_t eased[] = { OP_TRANSITION_EASED, 0, 0, 255, 0x2C, 0x01, EASING_COUNT - 1 };
+  TEST_ASSERT_EQUAL(PARSE_OK, parse(eased, sizeof(eased), cmd));
+  TEST_ASSERT_EQUAL_UINT32(300, cmd.duration);
+  TEST_ASSERT_EQUAL_UINT8(EASING_COUNT - 1, cmd.easing);
+}
+
+void test_unknown_easing_and_effect_are_rejected() {
+  Command cmd;
+  const uint8_t eased[] = { OP_TRANSITION_EASED, 0, 0, 255, 0x2C, 0x01, EASING_COUNT };
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parse(eased, sizeof(eased), cmd));
+
+  const uint8_t key[] = { OP_TIMELINE_KEY, 0, 0, 0, 0, 1, 2, 3, EASING_COUNT };
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parse(key, sizeof(key), cmd));
+
+  const uint8_t effect[] = { OP_EFFECT, EFFECT_TYPE_COUNT, 255, 0, 0, 0xF4, 0x01, 3, 100, 0 };
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parse(effect, sizeof(effect), cmd));
+}
+
+void test_effect_fields() {
+  Command cmd;
+  const uint8_t effect[] = { OP_EFFECT, 0, 255, 191, 0, 0xF4, 0x01, 6, 0x2C, 0x01 };
+  TEST_ASSERT_EQUAL(PARSE_OK, parse(effect, sizeof(effect), cmd));
+  TEST_ASSERT_EQUAL(CMD_EFFECT, cmd.type);
+  TEST_ASSERT_EQUAL_UINT8(0, cmd.effect);
+  TEST_ASSERT_EQUAL_UINT8(191, cmd.g);
+  TEST_ASSERT_EQUAL_UINT16(500, cmd.period);
+  TEST_ASSERT_EQUAL_UINT8(6, cmd.cycles);
+  TEST_ASSERT_EQUAL_UINT16(300, cmd.fade);
+}
+
+void test_frame_points_into_the_write() {
+  Command cmd;
+  const uint8_t frame[] = { OP_FRAME, 7, 2, 1, 2, 3, 4, 5, 6 };
+  TEST_ASSERT_EQUAL(PARSE_OK, parse(frame, sizeof(frame), cmd));
+  TEST_ASSERT_EQUAL(CMD_FRAME, cmd.type);
+  TEST_ASSERT_EQUAL_UINT16(2, cmd.start);
+  TEST_ASSERT_EQUAL_UINT16(2, cmd.count);
+  TEST_ASSERT_TRUE(cmd.pixels == frame + 3);
+
+  // START の後ろが3バイト単位でない
+  const uint8_t ragged[] = { OP_FRAME, 5, 0, 1, 2, 3, 4 };
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parse(ragged, sizeof(ragged), cmd));
+}
+
+void test_timeline_and_clock_commands() {
+  Command cmd;
+  const uint8_t key[] = { OP_TIMELINE_KEY, 0xE8, 0x03, 0, 0, 1, 2, 3, EASE_LINEAR };
+  TEST_ASSERT_EQUAL(PARSE_OK, parse(key, sizeof(key), cmd));
+  TEST_ASSERT_EQUAL(CMD_TIMELINE_KEY, cmd.type);
+  TEST_ASSERT_EQUAL_UINT32(1000, cmd.time);
+
+  const uint8_t play[] = { OP_TIMELINE_PLAY, TIMELINE_FLAG_LOOP };
+  TEST_ASSERT_EQUAL(PARSE_OK, parse(play, sizeof(play), cmd));
+  TEST_ASSERT_EQUAL(CMD_TIMELINE_PLAY, cmd.type);
+  TEST_ASSERT_EQUAL_UINT8(TIMELINE_FLAG_LOOP, cmd.flags);
+
+  const uint8_t clear[] = { OP_TIMELINE_CLEAR };
+  TEST_ASSERT_EQUAL(PARSE_OK, parse(clear, sizeof(clear), cmd));
+  TEST_ASSERT_EQUAL(CMD_TIMELINE_CLEAR, cmd.type);
+
+  const uint8_t set[] = { OP_TIME_SET, 0x78, 0x56, 0x34, 0x12 };
+  TEST_ASSERT_EQUAL(PARSE_OK, parse(set, sizeof(set), cmd));
+  TEST_ASSERT_EQUAL(CMD_TIME_SET, cmd.type);
+  TEST_ASSERT_EQUAL_UINT32(0x12345678, cmd.time);
+}
+
+void test_at_schedules_one_command() {
+  Command cmd;
+  const uint8_t at[] = { OP_AT, 8, 0x10, 0x27, 0, 0, OP_COLOR, 255, 0, 0 };
+  TEST_ASSERT_EQUAL(PARSE_OK, parse(at, sizeof(at), cmd));
+  TEST_ASSERT_EQUAL(CMD_COLOR, cmd.type);
+  TEST_ASSERT_TRUE(cmd.hasStartAt);
+  TEST_ASSERT_EQUAL_UINT32(10000, cmd.startAt);
+  TEST_ASSERT_EQUAL_UINT8(255, cmd.r);
+}
+
+void test_at_rejects_nesting_frames_and_leftovers() {
+  Command cmd;
+  const uint8_t nested[] = { OP_AT, 14, 0, 0, 0, 0, OP_AT, 8, 0, 0, 0, 0, OP_COLOR, 255, 0, 0 };
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parse(nested, sizeof(nested), cmd));
+
+  // フレームは受信時にステージへ書くので予約できない
+  const uint8_t frame[] = { OP_AT, 9, 0, 0, 0, 0, OP_FRAME, 4, 0, 1, 2, 3 };
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parse(frame, sizeof(frame), cmd));
+
+  // LEN がコマンドより長い
+  const uint8_t extra[] = { OP_AT, 7, 0, 0, 0, 0, OP_HUE, 1, 2 };
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parse(extra, sizeof(extra), cmd));
+}
+
+void test_unknown_and_truncated() {
+  Command cmd;
+  const uint8_t zero[] = { 0x00 };
+  TEST_ASSERT_EQUAL(PARSE_UNKNOWN, parse(zero, sizeof(zero), cmd));
+  const uint8_t beyond[] = { OPCODE_COUNT, 0, 0, 0 };
+  TEST_ASSERT_EQUAL(PARSE_UNKNOWN, parse(beyond, sizeof(beyond), cmd));
+
+  const uint8_t shortColor[] = { OP_COLOR, 1, 2 };
+  TEST_ASSERT_EQUAL(PARSE_TRUNCATED, parse(shortColor, sizeof(shortColor), cmd));
+  const uint8_t noLen[] = { OP_FRAME };
+  TEST_ASSERT_EQUAL(PARSE_TRUNCATED, parse(noLen, sizeof(noLen), cmd));
+  const uint8_t shortFrame[] = { OP_FRAME, 7, 0, 1, 2, 3 };
+  TEST_ASSERT_EQUAL(PARSE_TRUNCATED, parse(shortFrame, sizeof(shortFrame), cmd));
+
+  TEST_ASSERT_EQUAL(PARSE_EMPTY, parse(zero, 0, cmd));
+}
+
+void test_parse_command_dispatches_on_magic() {
+  Command cmd;
+  const uint8_t binary[] = { PROTOCOL_MAGIC, OP_COLOR, 1, 2, 3 };
+  TEST_ASSERT_EQUAL(PARSE_OK, parseCommand(binary, sizeof(binary), cmd));
+  TEST_ASSERT_EQUAL(CMD_COLOR, cmd.type);
+  TEST_ASSERT_EQUAL_UINT8(3, cmd.b);
+
+  const uint8_t ascii[] = { 'H', ':', '9' };
+  TEST_ASSERT_EQUAL(PARSE_OK, parseCommand(ascii, sizeof(ascii), cmd));
+  TEST_ASSERT_EQUAL(CMD_HUE, cmd.type);
+  TEST_ASSERT_EQUAL_UINT8(9, cmd.hue);
+
+  const uint8_t magicOnly[] = { PROTOCOL_MAGIC };
+  TEST_ASSERT_EQUAL(PARSE_EMPTY, parseCommand(magicOnly, sizeof(magicOnly), cmd));
+}
+
+void test_time_reply_layout() {
+  uint8_t reply[TIME_REPLY_LENGTH];
+  encodeTimeReply(reply, 0x01020304, 0x11121314, 0x21222324);
+  const uint8_t expected[TIME_REPLY_LENGTH] = {
+    PROTOCOL_MAGIC, OP_TIME_PING,
+    0x04, 0x03, 0x02, 0x01,
+    0x14, 0x13, 0x12, 0x11,
+    0x24, 0x23, 0x22, 0x21,
+  };
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, reply, TIME_REPLY_LENGTH);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_color_hue_and_mode);
+  RUN_TEST(test_mode_above_one_is_rejected);
+  RUN_TEST(test_transition_reads_little_endian_duration);
+  RUN_TEST(test_unknown_easing_and_effect_are_rejected);
+  RUN_TEST(test_effect_fields);
+  RUN_TEST(test_frame_points_into_the_write);
+  RUN_TEST(test_timeline_and_clock_commands);
+  RUN_TEST(test_at_schedules_one_command);
+  RUN_TEST(test_at_rejects_nesting_frames_and_leftovers);
+  RUN_TEST(test_unknown_and_truncated);
+  RUN_TEST(test_parse_command_dispatches_on_magic);
+  RUN_TEST(test_time_reply_layout);
+  return UNITY_END();
+}
@@ -0,0 +1,140 @@
+// アドバタイズによる配信（broadcast.h）の解析と、SEQ による重複除去・宛先判定のテスト
+//   pio test -e native -f test_broadcast
+
+#include <unity.h>
+#include <string.h>
+
+#include "broadcast.h"
+
+void setUp() {}
+void tearDown() {}
+
+// COMPANY_ID(u16),TAG,SEQ(u16),TARGETS の後ろに command を付けたメーカー固有データを作る
+static size_t makeData(uint8_t* out, uint16_t seq, uint8_t targets, const uint8_t* command, size_t commandLen) {
+  out[0] = BROADCAST_COMPANY_ID & 0xFF;
+  out[1] = BROADCAST_COMPANY_ID >> 8;
+  out[2] = BROADCAST_TAG;
+  out[3] = seq & 0xFF;
+  out[4] = seq >> 8;
+  out[5] = targets;
+  memcpy(out + BROADCAST_HEADER, command, commandLen);
+  return BROADCAST_HEADER + commandLen;
+}
+
+static BroadcastPacket packet(uint16_t seq, uint8_t targets) {
+  BroadcastPacket p;
+  memset(&p, 0, sizeof(p));
+  p.seq = seq;
+  p.targets = targets;
+  return p;
+}
+
+void test_parse_builds_write() {
+  const uint8_t command[] = { OP_COLOR, 1, 2, 3 };
+  uint8_t data[32];
+  size_t len = makeData(data, 0x1234, 0x03, command, sizeof(command));
+
+  BroadcastPacket out;
+  TEST_ASSERT_EQUAL(PARSE_OK, parseBroadcast(data, len, out));
+  TEST_ASSERT_EQUAL_UINT16(0x1234, out.seq);
+  TEST_ASSERT_EQUAL_UINT8(0x03, out.targets);
+  TEST_ASSERT_EQUAL(sizeof(command) + 1, out.writeLen);
+  TEST_ASSERT_EQUAL_UINT8(PROTOCOL_MAGIC, out.write[0]);
+  TEST_ASSERT_EQUAL_MEMORY(command, out.write + 1, sizeof(command));
+}
+
+void test_parse_rejects_foreign_and_malformed_data() {
+  const uint8_t command[] = { OP_HUE, 9 };
+  uint8_t data[64];
+  BroadcastPacket out;
+
+  size_t len = makeData(data, 1, 1, command, sizeof(command));
+  data[0] = 0x4C; // 別のメーカー
+  TEST_ASSERT_EQUAL(PARSE_UNKNOWN, parseBroadcast(data, len, out));
+
+  len = makeData(data, 1, 1, command, sizeof(command));
+  data[2] = BROADCAST_TAG + 1;
+  TEST_ASSERT_EQUAL(PARSE_UNKNOWN, parseBroadcast(data, len, out));
+
+  len = makeData(data, 1, 1, command, sizeof(command));
+  TEST_ASSERT_EQUAL(PARSE_TRUNCATED, parseBroadcast(data, BROADCAST_HEADER - 1, out));
+  TEST_ASSERT_EQUAL(PARSE_EMPTY, parseBroadcast(data, BROADCAST_HEADER, out));
+  TEST_ASSERT_EQUAL(PARSE_TRUNCATED, parseBroadcast(data, len - 1, out));
+
+  // コマンドの後ろに余分なバイトがある
+  const uint8_t extra[] = { OP_HUE, 9, 0 };
+  len = makeData(data, 1, 1, extra, sizeof(extra));
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parseBroadcast(data, len, out));
+
+  // 範囲外の値は書き込みと同じく拒否する
+  const uint8_t mode[] = { OP_MODE, 2 };
+  len = makeData(data, 1, 1, mode, sizeof(mode));
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parseBroadcast(data, len, out));
+
+  // BROADCAST_WRITE_MAX に収まらない
+  uint8_t frame[BROADCAST_WRITE_MAX] = { OP_FRAME, BROADCAST_WRITE_MAX - 2, 0 };
+  len = makeData(data, 1, 1, frame, sizeof(frame));
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parseBroadcast(data, len, out));
+}
+
+void test_filter_drops_repeated_seq() {
+  BroadcastFilter filter;
+  TEST_ASSERT_TRUE(filter.accept(packet(10, BROADCAST_TARGET_ALL), 1, 1000));
+  // ホストは同じアドバタイズを繰り返す
+  for (uint32_t t = 1010; t < 1100; t += 10) {
+    TEST_ASSERT_FALSE(filter.accept(packet(10, BROADCAST_TARGET_ALL), 1, t));
+  }
+  TEST_ASSERT_TRUE(filter.accept(packet(11, BROADCAST_TARGET_ALL), 1, 1100));
+  TEST_ASSERT_FALSE(filter.accept(packet(10, BROADCAST_TARGET_ALL), 1, 1110));
+  TEST_ASSERT_EQUAL_UINT32(2, filter.acceptedCount());
+  TEST_ASSERT_EQUAL_UINT32(10, filter.duplicateCount());
+}
+
+// 覚えておく SEQ は直近 BROADCAST_DEDUP_HISTORY 個
+void test_filter_history_is_bounded() {
+  BroadcastFilter filter;
+  for (uint16_t seq = 0; seq <= BROADCAST_DEDUP_HISTORY; seq++) {
+    TEST_ASSERT_TRUE(filter.accept(packet(seq, BROADCAST_TARGET_ALL), 2, 100 + seq));
+  }
+  TEST_ASSERT_FALSE(filter.accept(packet(BROADCAST_DEDUP_HISTORY, BROADCAST_TARGET_ALL), 2, 200));
+  TEST_ASSERT_FALSE(filter.accept(packet(1, BROADCAST_TARGET_ALL), 2, 200));
+  // SEQ 0 は押し出された
+  TEST_ASSERT_TRUE(filter.accept(packet(0, BROADCAST_TARGET_ALL), 2, 200));
+}
+
+void test_filter_checks_targets() {
+  BroadcastFilter filter;
+  TEST_ASSERT_FALSE(filter.accept(packet(1, 0x02), 1, 0));
+  TEST_ASSERT_TRUE(filter.accept(packet(1, 0x02), 2, 0));
+  TEST_ASSERT_TRUE(filter.accept(packet(2, 0x80), 8, 0));
+  TEST_ASSERT_FALSE(filter.accept(packet(3, BROADCAST_TARGET_ALL), 0, 0));
+  TEST_ASSERT_FALSE(filter.accept(packet(3, BROADCAST_TARGET_ALL), 9, 0));
+  // 宛先外のものは重複として数えない
+  TEST_ASSERT_EQUAL_UINT32(0, filter.duplicateCount());
+}
+
+// アドバタイズが途切れたら履歴を忘れ、ホストの再起動で SEQ が戻っても受け付ける
+void test_filter_history_expires() {
+  BroadcastFilter filter;
+  TEST_ASSERT_TRUE(filter.accept(packet(5, BROADCAST_TARGET_ALL), 1, 1000));
+  TEST_ASSERT_FALSE(filter.accept(packet(5, BROADCAST_TARGET_ALL), 1, 1000 + BROADCAST_DEDUP_EXPIRE_MS));
+  // 最後に受信してから BROADCAST_DEDUP_EXPIRE_MS を超えた
+  uint32_t later = 1000 + 2 * BROADCAST_DEDUP_EXPIRE_MS + 1;
+  TEST_ASSERT_TRUE(filter.accept(packet(5, BROADCAST_TARGET_ALL), 1, later));
+
+  // millis() が1周しても経過時間で判定する
+  BroadcastFilter wrapped;
+  TEST_ASSERT_TRUE(wrapped.accept(packet(7, BROADCAST_TARGET_ALL), 1, UINT32_MAX - 100));
+  TEST_ASSERT_FALSE(wrapped.accept(packet(7, BROADCAST_TARGET_ALL), 1, 100));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_parse_builds_write);
+  RUN_TEST(test_parse_rejects_foreign_and_malformed_data);
+  RUN_TEST(test_filter_drops_repeated_seq);
+  RUN_TEST(test_filter_history_is_bounded);
+  RUN_TEST(test_filter_checks_targets);
+  RUN_TEST(test_filter_history_expires);
+  return UNITY_END();
+}
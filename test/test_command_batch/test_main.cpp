@@ -0,0 +1,339 @@
+// 1回の書き込みに複数のコマンドを入れたバッチのテスト
+// 解析（parseCommandBatch）、キューへの追加（enqueueBatch）、もう片方の耳への転送（relayBatch）
+//   pio test -e native -f test_command_batch
+
+#include <unity.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+
+#include "command_receiver.h"
+#include "frame_engine.h"
+#include "led_strip.h"
+#include "xy_map.h"
+
+using TestStrip = LedStrip<StripLayout<4, 12>>;
+using TestMap = XyMap<TestStrip::layout, XY_ROW_MAJOR>;
+using TestEngine = FrameEngine<TestStrip, TestMap>;
+
+#define TEST_PEER_GROUP 3
+
+void setUp() {}
+void tearDown() {}
+
+static ParseResult parseText(const char* text, CommandBatch& batch) {
+  return parseCommandBatch((const uint8_t*)text, strlen(text), batch);
+}
+
+// 仮想時計の FramePlatform（左右の耳で時計を共有する）
+class TestPlatform : public FramePlatform {
+public:
+  explicit TestPlatform(const uint32_t& clockUs) : clockUs_(clockUs) {}
+
+  uint32_t nowMs() override { return clockUs_ / 1000; }
+  uint32_t nowUs() override { return clockUs_; }
+  uint8_t brightness() override { return 255; }
+  void show() override {}
+  void sendStatsReport(uint8_t, uint8_t) override {}
+  void sendTimeReply(const Command&) override {}
+
+private:
+  const uint32_t& clockUs_;
+};
+
+// 2つをつなぐピアリンク: 送ったパケットは PEER_LINK_LATENCY_MS 後に相手に届く
+class TestPeerLink : public PeerLink {
+public:
+  explicit TestPeerLink(const uint32_t& clockUs) : clockUs_(clockUs) {}
+
+  static void connect(TestPeerLink& a, TestPeerLink& b) {
+    a.remote_ = &b;
+    b.remote_ = &a;
+  }
+
+  bool send(const uint8_t* data, size_t len) override {
+    sent.push_back(std::vector<uint8_t>(data, data + len));
+    if (remote_) {
+      remote_->inbox_.push_back({ std::vector<uint8_t>(data, data + len), nowMs() + PEER_LINK_LATENCY_MS });
+    }
+    return true;
+  }
+
+  bool receive(uint8_t* data, size_t& len, uint32_t& receivedMs) override {
+    if (inbox_.empty() || (int32_t)(nowMs() - inbox_.front().receivedMs) < 0) {
+      return false;
+    }
+    len = inbox_.front().data.size();
+    memcpy(data, inbox_.front().data.data(), len);
+    receivedMs = inbox_.front().receivedMs;
+    inbox_.pop_front();
+    return true;
+  }
+
+  std::vector<std::vector<uint8_t>> sent;
+
+private:
+  struct Packet {
+    std::vector<uint8_t> data;
+    uint32_t receivedMs;
+  };
+
+  uint32_t nowMs() const { return clockUs_ / 1000; }
+
+  const uint32_t& clockUs_;
+  TestPeerLink* remote_ = nullptr;
+  std::deque<Packet> inbox_;
+};
+
+// OP_TIMELINE_CLEAR、キーフレーム keys 個、OP_TIMELINE_PLAY のバイナリ形式の書き込み
+static size_t makeTimelineWrite(uint8_t* out, size_t keys) {
+  size_t len = 0;
+  out[len++] = PROTOCOL_MAGIC;
+  out[len++] = OP_TIMELINE_CLEAR;
+  for (size_t i = 0; i < keys; i++) {
+    uint32_t time = i * 100;
+    const uint8_t key[] = { OP_TIMELINE_KEY, (uint8_t)time, (uint8_t)(time >> 8), 0, 0,
+                            (uint8_t)(i % 2 ? 255 : 0), (uint8_t)(i * 20), 40, EASE_LINEAR };
+    memcpy(out + len, key, sizeof(key));
+    len += sizeof(key);
+  }
+  out[len++] = OP_TIMELINE_PLAY;
+  out[len++] = 0;
+  return len;
+}
+
+void test_ascii_batch_records_spans() {
+  const char* text = "C:1,2,3\n\n  H:5\r\nM:1";
+  CommandBatch batch;
+  TEST_ASSERT_EQUAL(PARSE_OK, parseText(text, batch));
+  TEST_ASSERT_FALSE(batch.binary);
+  TEST_ASSERT_EQUAL(3, batch.count);
+  TEST_ASSERT_EQUAL(CMD_COLOR, batch.commands[0].type);
+  TEST_ASSERT_EQUAL(CMD_HUE, batch.commands[1].type);
+  TEST_ASSERT_EQUAL(CMD_MODE, batch.commands[2].type);
+
+  // span は前後の空白を除いた1行（relayBatch() が元の形式のまま転送するのに使う）
+  TEST_ASSERT_EQUAL_UINT16(0, batch.spanStart[0]);
+  TEST_ASSERT_EQUAL_UINT16(7, batch.spanLen[0]);
+  TEST_ASSERT_EQUAL_MEMORY("H:5", text + batch.spanStart[1], 3);
+  TEST_ASSERT_EQUAL_MEMORY("M:1", text + batch.spanStart[2], batch.spanLen[2]);
+}
+
+void test_binary_batch_records_spans() {
+  const uint8_t data[] = { PROTOCOL_MAGIC, OP_COLOR, 1, 2, 3, OP_HUE, 9, OP_TIMELINE_CLEAR };
+  CommandBatch batch;
+  TEST_ASSERT_EQUAL(PARSE_OK, parseCommandBatch(data, sizeof(data), batch));
+  TEST_ASSERT_TRUE(batch.binary);
+  TEST_ASSERT_EQUAL(3, batch.count);
+  TEST_ASSERT_EQUAL(CMD_HUE, batch.commands[1].type);
+  TEST_ASSERT_EQUAL_UINT8(9, batch.commands[1].hue);
+  TEST_ASSERT_EQUAL_UINT16(1, batch.spanStart[0]);
+  TEST_ASSERT_EQUAL_UINT16(4, batch.spanLen[0]);
+  TEST_ASSERT_EQUAL_UINT16(5, batch.spanStart[1]);
+  TEST_ASSERT_EQUAL_UINT16(2, batch.spanLen[1]);
+  TEST_ASSERT_EQUAL_UINT16(7, batch.spanStart[2]);
+  TEST_ASSERT_EQUAL_UINT16(1, batch.spanLen[2]);
+}
+
+void test_batch_size_limit() {
+  static uint8_t data[1 + (COMMAND_BATCH_MAX + 1) * 2];
+  CommandBatch batch;
+  data[0] = PROTOCOL_MAGIC;
+  for (size_t i = 0; i <= COMMAND_BATCH_MAX; i++) {
+    data[1 + i * 2] = OP_HUE;
+    data[2 + i * 2] = (uint8_t)i;
+  }
+  TEST_ASSERT_EQUAL(PARSE_OK, parseCommandBatch(data, 1 + COMMAND_BATCH_MAX * 2, batch));
+  TEST_ASSERT_EQUAL(COMMAND_BATCH_MAX, batch.count);
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parseCommandBatch(data, 1 + (COMMAND_BATCH_MAX + 1) * 2, batch));
+  TEST_ASSERT_EQUAL(0, batch.count);
+
+  char text[COMMAND_BATCH_MAX * 6 + 8] = "";
+  for (size_t i = 0; i <= COMMAND_BATCH_MAX; i++) {
+    strcat(text, "H:1\n");
+  }
+  TEST_ASSERT_EQUAL(PARSE_INVALID, parseText(text, batch));
+  TEST_ASSERT_EQUAL(0, batch.count);
+}
+
+// 1つでも不正なコマンドがあれば全体を捨てる
+void test_error_discards_whole_batch() {
+  CommandBatch batch;
+  TEST_ASSERT_EQUAL(PARSE_OUT_OF_RANGE, parseText("C:1,2,3\nH:300\nM:1", batch));
+  TEST_ASSERT_EQUAL(0, batch.count);
+
+  const uint8_t truncated[] = { PROTOCOL_MAGIC, OP_HUE, 1, OP_COLOR, 1, 2 };
+  TEST_ASSERT_EQUAL(PARSE_TRUNCATED, parseCommandBatch(truncated, sizeof(truncated), batch));
+  TEST_ASSERT_EQUAL(0, batch.count);
+
+  TEST_ASSERT_EQUAL(PARSE_EMPTY, parseText("", batch));
+  TEST_ASSERT_EQUAL(PARSE_EMPTY, parseText("\n \r\n", batch));
+  const uint8_t magicOnly[] = { PROTOCOL_MAGIC };
+  TEST_ASSERT_EQUAL(PARSE_EMPTY, parseCommandBatch(magicOnly, sizeof(magicOnly), batch));
+}
+
+// キューにバッチ全体の空きがなければ、ピクセルフレームもステージに書かずに PARSE_BUSY
+void test_enqueue_refuses_batch_the_queue_cannot_hold() {
+  static FrameStage<TestStrip::SIZE> stage;
+  static SpscRing<Command, 4> queue;
+  static CRGB latched[TestStrip::SIZE];
+  stage.latch(latched);
+
+  CommandBatch filler;
+  TEST_ASSERT_EQUAL(PARSE_OK, parseText("H:1\nH:2\nH:3", filler));
+  TEST_ASSERT_EQUAL(PARSE_OK, enqueueBatch(filler, 0, stage, queue));
+
+  // OP_FRAME（START=0、1画素）と OP_COLOR の2コマンド
+  const uint8_t data[] = { PROTOCOL_MAGIC, OP_FRAME, 4, 0, 10, 20, 30, OP_COLOR, 1, 2, 3 };
+  CommandBatch batch;
+  TEST_ASSERT_EQUAL(PARSE_OK, parseCommandBatch(data, sizeof(data), batch));
+  TEST_ASSERT_EQUAL(PARSE_BUSY, enqueueBatch(batch, 0, stage, queue));
+  TEST_ASSERT_FALSE(stage.latch(latched));
+  TEST_ASSERT_EQUAL(3, queue.size());
+
+  // 空きができれば受け付ける
+  Command cmd;
+  TEST_ASSERT_TRUE(queue.pop(cmd));
+  TEST_ASSERT_EQUAL(PARSE_OK, parseCommandBatch(data, sizeof(data), batch));
+  TEST_ASSERT_EQUAL(PARSE_OK, enqueueBatch(batch, 0, stage, queue));
+  TEST_ASSERT_TRUE(stage.latch(latched));
+  TEST_ASSERT_TRUE(latched[0] == CRGB(10, 20, 30));
+
+  // バッチの最後のコマンドに印が付く
+  TEST_ASSERT_TRUE(queue.pop(cmd));
+  TEST_ASSERT_TRUE(queue.pop(cmd));
+  TEST_ASSERT_TRUE(cmd.batchEnd);
+  TEST_ASSERT_TRUE(queue.pop(cmd));
+  TEST_ASSERT_EQUAL(CMD_FRAME, cmd.type);
+  TEST_ASSERT_FALSE(cmd.batchEnd);
+  TEST_ASSERT_TRUE(queue.pop(cmd));
+  TEST_ASSERT_EQUAL(CMD_COLOR, cmd.type);
+  TEST_ASSERT_TRUE(cmd.batchEnd);
+}
+
+// 不正な差分があれば、先に書いたピクセルフレームも含めてステージに何も見せない
+void test_invalid_delta_leaves_stage_untouched() {
+  static FrameStage<TestStrip::SIZE> stage;
+  static SpscRing<Command, 8> queue;
+  static CRGB latched[TestStrip::SIZE];
+  stage.latch(latched);
+
+  // OP_FRAME（START=0、1画素）と、画素の範囲を越える OP_FRAME_DELTA（START=47、COUNT=2）
+  const uint8_t data[] = { PROTOCOL_MAGIC, OP_FRAME, 4, 0, 10, 20, 30,
+                           OP_FRAME_DELTA, 8, 47, 2, 1, 1, 1, 2, 2, 2 };
+  CommandBatch batch;
+  TEST_ASSERT_EQUAL(PARSE_OK, parseCommandBatch(data, sizeof(data), batch));
+  TEST_ASSERT_EQUAL(PARSE_INVALID, enqueueBatch(batch, 0, stage, queue));
+  TEST_ASSERT_FALSE(stage.latch(latched));
+  TEST_ASSERT_EQUAL(0, queue.size());
+  TEST_ASSERT_EQUAL_UINT32(0, queue.droppedCount());
+
+  // 正しい差分なら両方がまとめて見える
+  const uint8_t valid[] = { PROTOCOL_MAGIC, OP_FRAME, 4, 0, 10, 20, 30,
+                            OP_FRAME_DELTA, 5, 46, DELTA_RUN_FLAG | 2, 7, 8, 9 };
+  TEST_ASSERT_EQUAL(PARSE_OK, parseCommandBatch(valid, sizeof(valid), batch));
+  TEST_ASSERT_EQUAL(PARSE_OK, enqueueBatch(batch, 0, stage, queue));
+  TEST_ASSERT_TRUE(stage.latch(latched));
+  TEST_ASSERT_TRUE(latched[0] == CRGB(10, 20, 30));
+  TEST_ASSERT_TRUE(latched[46] == CRGB(7, 8, 9));
+  TEST_ASSERT_TRUE(latched[47] == CRGB(7, 8, 9));
+}
+
+// 転送時に開始時刻を付けるのは画を変えるコマンドだけ（消去・キーフレームの追加はすぐ反映する）
+void test_relay_stamps_only_state_commands() {
+  uint32_t clockUs = 0;
+  TestPeerLink link(clockUs);
+  uint8_t data[128];
+  size_t len = makeTimelineWrite(data, 4);
+  CommandBatch batch;
+  TEST_ASSERT_EQUAL(PARSE_OK, parseCommandBatch(data, len, batch));
+  TEST_ASSERT_TRUE(stampRelayBatch(batch, 500 + PEER_RELAY_LEAD_MS));
+  TEST_ASSERT_TRUE(relayBatch(link, TEST_PEER_GROUP, data, batch, true, 500 + PEER_RELAY_LEAD_MS));
+
+  for (size_t i = 0; i + 1 < batch.count; i++) {
+    TEST_ASSERT_FALSE(batch.commands[i].hasStartAt);
+  }
+  const Command& play = batch.commands[batch.count - 1];
+  TEST_ASSERT_EQUAL(CMD_TIMELINE_PLAY, play.type);
+  TEST_ASSERT_TRUE(play.hasStartAt);
+  TEST_ASSERT_EQUAL_UINT32(500 + PEER_RELAY_LEAD_MS, play.startAt);
+
+  // 書き込みは元の形式のまま1パケットで送る
+  TEST_ASSERT_EQUAL(1, link.sent.size());
+  PeerPacket packet;
+  TEST_ASSERT_TRUE(parsePeerPacket(link.sent[0].data(), link.sent[0].size(), TEST_PEER_GROUP, packet));
+  TEST_ASSERT_TRUE(packet.hasStartAt);
+  TEST_ASSERT_EQUAL_UINT32(500 + PEER_RELAY_LEAD_MS, packet.time);
+  TEST_ASSERT_EQUAL(len, packet.writeLen);
+  TEST_ASSERT_EQUAL_MEMORY(data, packet.write, len);
+}
+
+// キーフレーム10個を含む12コマンドのバッチも、転送先で全部反映されて左右が同じ画になる
+void test_relayed_batch_plays_in_sync() {
+  static TestEngine primary;
+  static TestEngine secondary;
+  uint32_t clockUs = 0;
+  TestPlatform primaryPlatform(clockUs);
+  TestPlatform secondaryPlatform(clockUs);
+  TestPeerLink primaryLink(clockUs);
+  TestPeerLink secondaryLink(clockUs);
+  TestPeerLink::connect(primaryLink, secondaryLink);
+  primary.setPeer(&primaryLink, PEER_ROLE_PRIMARY, TEST_PEER_GROUP);
+  secondary.setPeer(&secondaryLink, PEER_ROLE_SECONDARY, TEST_PEER_GROUP);
+
+  uint8_t data[128];
+  size_t len = makeTimelineWrite(data, 10);
+  TEST_ASSERT_EQUAL(PARSE_OK, primary.receiveHostWrite(data, len, clockUs, clockUs / 1000));
+
+  bool started = false;
+  for (uint32_t ms = 0; ms < 1200; ms++) {
+    clockUs = ms * 1000;
+    primary.runFrame(primaryPlatform);
+    secondary.runFrame(secondaryPlatform);
+    if (ms == PEER_LINK_LATENCY_MS) {
+      // キーフレームはすぐ反映し、再生だけを予約している
+      TEST_ASSERT_EQUAL(1, (int)secondary.scheduler().pending());
+    }
+    TEST_ASSERT_EQUAL(primary.controller().mode(), secondary.controller().mode());
+    TEST_ASSERT_EQUAL_MEMORY(primary.leds().pixels(), secondary.leds().pixels(), TestStrip::SIZE * sizeof(CRGB));
+    started = started || secondary.controller().mode() == MODE_TIMELINE;
+  }
+  TEST_ASSERT_TRUE(started);
+  TEST_ASSERT_EQUAL(0, (int)secondary.scheduler().pending());
+}
+
+// プライマリが自分のキューに積めなかった書き込みはセカンダリへ転送しない
+void test_primary_relays_only_accepted_writes() {
+  static TestEngine primary;
+  uint32_t clockUs = 0;
+  TestPeerLink primaryLink(clockUs);
+  primary.setPeer(&primaryLink, PEER_ROLE_PRIMARY, TEST_PEER_GROUP);
+
+  // 画素の範囲外のフレーム
+  const uint8_t frame[] = { PROTOCOL_MAGIC, OP_COLOR, 1, 2, 3, OP_FRAME, 4, TestStrip::SIZE, 1, 2, 3 };
+  TEST_ASSERT_EQUAL(PARSE_OUT_OF_RANGE, primary.receiveHostWrite(frame, sizeof(frame), 0, 0));
+  TEST_ASSERT_EQUAL(0, primaryLink.sent.size());
+
+  // キューが満杯
+  const char* hue = "H:1";
+  for (size_t i = 0; i < COMMAND_QUEUE_SIZE; i++) {
+    TEST_ASSERT_EQUAL(PARSE_OK, primary.receiveHostWrite((const uint8_t*)hue, strlen(hue), 0, 0));
+  }
+  TEST_ASSERT_EQUAL(COMMAND_QUEUE_SIZE, primaryLink.sent.size());
+  TEST_ASSERT_EQUAL(PARSE_BUSY, primary.receiveHostWrite((const uint8_t*)hue, strlen(hue), 0, 0));
+  TEST_ASSERT_EQUAL(COMMAND_QUEUE_SIZE, primaryLink.sent.size());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_ascii_batch_records_spans);
+  RUN_TEST(test_binary_batch_records_spans);
+  RUN_TEST(test_batch_size_limit);
+  RUN_TEST(test_error_discards_whole_batch);
+  RUN_TEST(test_enqueue_refuses_batch_the_queue_cannot_hold);
+  RUN_TEST(test_invalid_delta_leaves_stage_untouched);
+  RUN_TEST(test_relay_stamps_only_state_commands);
+  RUN_TEST(test_relayed_batch_plays_in_sync);
+  RUN_TEST(test_primary_relays_only_accepted_writes);
+  return UNITY_END();
+}
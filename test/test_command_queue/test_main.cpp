@@ -0,0 +1,141 @@
+// SpscRing（command_queue.h）と遅延ログのキュー（log.h、複数プロデューサ）のテスト
+// 2つのスレッドで BLE のタスクと loop() の受け渡しを再現する
+//   pio test -e native -f test_command_queue
+
+#include <unity.h>
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+
+#include "command_queue.h"
+#include "log.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_push_pop_in_order_and_count_drops() {
+  SpscRing<uint32_t, 4> ring;
+  for (uint32_t i = 0; i < 4; i++) {
+    TEST_ASSERT_TRUE(ring.push(i));
+  }
+  TEST_ASSERT_FALSE(ring.push(4));
+  TEST_ASSERT_EQUAL_UINT32(4, ring.pushedCount());
+  TEST_ASSERT_EQUAL_UINT32(1, ring.droppedCount());
+
+  uint32_t value;
+  for (uint32_t i = 0; i < 4; i++) {
+    TEST_ASSERT_TRUE(ring.pop(value));
+    TEST_ASSERT_EQUAL_UINT32(i, value);
+  }
+  TEST_ASSERT_FALSE(ring.pop(value));
+}
+
+void test_push_all_is_all_or_nothing() {
+  SpscRing<uint32_t, 8> ring;
+  const uint32_t items[6] = { 1, 2, 3, 4, 5, 6 };
+  TEST_ASSERT_TRUE(ring.pushAll(items, 6));
+  TEST_ASSERT_FALSE(ring.reserve(3));
+  TEST_ASSERT_FALSE(ring.pushAll(items, 3));
+  TEST_ASSERT_EQUAL_UINT32(6, ring.droppedCount()); // reserve() と pushAll() の3個ずつ
+  TEST_ASSERT_EQUAL(6, ring.size());
+
+  uint32_t value;
+  TEST_ASSERT_TRUE(ring.pop(value));
+  TEST_ASSERT_TRUE(ring.reserve(3));
+  TEST_ASSERT_TRUE(ring.pushAll(items, 3));
+  TEST_ASSERT_EQUAL(8, ring.size());
+}
+
+// プロデューサは連番をまとめて積み、コンシューマは順序と抜けを確かめる
+void test_spsc_two_threads_keep_order() {
+  static SpscRing<uint32_t, 32> ring;
+  const uint32_t total = 200000;
+  std::atomic<bool> done{false};
+
+  std::thread producer([&] {
+    uint32_t next = 0;
+    while (next < total) {
+      uint32_t batch[3] = { next, next + 1, next + 2 };
+      size_t n = total - next < 3 ? total - next : 3;
+      if (ring.pushAll(batch, n)) {
+        next += n;
+      }
+    }
+    done.store(true, std::memory_order_release);
+  });
+
+  uint32_t expected = 0;
+  bool ordered = true;
+  uint32_t value;
+  while (!done.load(std::memory_order_acquire) || ring.size() > 0) {
+    while (ring.pop(value)) {
+      ordered = ordered && value == expected;
+      expected++;
+    }
+  }
+  producer.join();
+  while (ring.pop(value)) {
+    ordered = ordered && value == expected;
+    expected++;
+  }
+
+  TEST_ASSERT_TRUE(ordered);
+  TEST_ASSERT_EQUAL_UINT32(total, expected);
+  TEST_ASSERT_EQUAL_UINT32(total, ring.pushedCount());
+}
+
+// 2つのタスクが同時にログを積み、loop() 側で取り出す
+// 取り出したログはどれも壊れておらず、タスクごとの順序が保たれ、積めなかった分は破棄数に入る
+void test_log_queue_two_producers() {
+  char line[LOG_LINE_MAX];
+  uint8_t level;
+  while (logPop(line, sizeof(line), level)) {
+  }
+  uint32_t droppedBefore = logDroppedCount();
+
+  const int32_t perProducer = 20000;
+  std::atomic<int> running{2};
+  auto produce = [&](int32_t id) {
+    for (int32_t i = 0; i < perProducer; i++) {
+      const int32_t args[LOG_MAX_ARGS] = { id, i, id * 7 + i };
+      logPush(LOG_LEVEL_INFO, "p=%d n=%d check=%d", args);
+    }
+    running.fetch_sub(1, std::memory_order_release);
+  };
+  std::thread a(produce, 1);
+  std::thread b(produce, 2);
+
+  int32_t last[3] = { -1, -1, -1 };
+  uint32_t received = 0;
+  bool valid = true;
+  for (;;) {
+    bool finished = running.load(std::memory_order_acquire) == 0;
+    while (logPop(line, sizeof(line), level)) {
+      int id, n, check;
+      if (sscanf(line, "p=%d n=%d check=%d", &id, &n, &check) != 3 || (id != 1 && id != 2) ||
+          check != id * 7 + n || n <= last[id] || level != LOG_LEVEL_INFO) {
+        valid = false;
+        continue;
+      }
+      last[id] = n;
+      received++;
+    }
+    if (finished) {
+      break;
+    }
+  }
+  a.join();
+  b.join();
+
+  TEST_ASSERT_TRUE(valid);
+  TEST_ASSERT_EQUAL_UINT32(2 * perProducer, received + (logDroppedCount() - droppedBefore));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_push_pop_in_order_and_count_drops);
+  RUN_TEST(test_push_all_is_all_or_nothing);
+  RUN_TEST(test_spsc_two_threads_keep_order);
+  RUN_TEST(test_log_queue_two_producers);
+  return UNITY_END();
+}
@@ -0,0 +1,110 @@
+// 進行度（progress16）とイージングカーブ（applyEasing）の境界のテスト
+//   pio test -e native -f test_easing
+
+#include <unity.h>
+
+#include "color_math.h"
+#include "easing.h"
+
+void setUp() {}
+void tearDown() {}
+
+// 終了直前でも進行度は 1.0 未満（lerp8 が終点を越えない）
+void test_progress_stays_below_one() {
+  const uint32_t durations[] = { 1, 2, 255, 65535, 65536, 65537, 131071, 131072, 1000000, 0x80000000u, UINT32_MAX };
+  for (uint32_t duration : durations) {
+    TEST_ASSERT_EQUAL_UINT32(0, progress16(0, duration));
+    TEST_ASSERT_LESS_THAN_UINT32(PROGRESS_ONE, progress16(duration - 1, duration));
+  }
+  // 縮めると elapsed == duration になる例
+  TEST_ASSERT_EQUAL_UINT32(PROGRESS_ONE - 1, progress16(131070, 131071));
+}
+
+void test_progress_midpoint() {
+  TEST_ASSERT_EQUAL_UINT32(PROGRESS_ONE / 2, progress16(1, 2));
+  TEST_ASSERT_EQUAL_UINT32(PROGRESS_ONE / 2, progress16(500, 1000));
+  TEST_ASSERT_UINT32_WITHIN(1, PROGRESS_ONE / 2, progress16(2000000000u, 4000000000u));
+  TEST_ASSERT_UINT32_WITHIN(1, PROGRESS_ONE / 4, progress16(25000, 100000));
+}
+
+// 長い遷移でも経過時間とともに進行度が戻らない
+void test_progress_is_monotonic_for_long_durations() {
+  const uint32_t durations[] = { 65536, 100000, 3600000, UINT32_MAX };
+  for (uint32_t duration : durations) {
+    uint32_t previous = 0;
+    uint32_t step = duration / 4096;
+    for (uint32_t elapsed = 0; elapsed < duration - step; elapsed += step) {
+      uint32_t progress = progress16(elapsed, duration);
+      TEST_ASSERT_GREATER_OR_EQUAL_UINT32(previous, progress);
+      previous = progress;
+    }
+  }
+}
+
+// 遷移時間 0 は進行度を求めずに終点の色
+void test_zero_duration_jumps_to_target() {
+  const CRGB from(0, 0, 0);
+  const CRGB to(10, 20, 30);
+  TEST_ASSERT_TRUE(lerpColor(from, to, 0, 0) == to);
+  TEST_ASSERT_TRUE(easeColor(from, to, 0, 0, EASE_IN_OUT_CUBIC) == to);
+  TEST_ASSERT_TRUE(easeColor(from, to, 5, 5, EASE_STEP) == to);
+}
+
+void test_lerp_endpoints() {
+  TEST_ASSERT_EQUAL_UINT8(0, lerp8(0, 255, 0));
+  TEST_ASSERT_EQUAL_UINT8(254, lerp8(0, 255, PROGRESS_ONE - 1));
+  TEST_ASSERT_EQUAL_UINT8(255, lerp8(255, 0, 0));
+  TEST_ASSERT_EQUAL_UINT8(100, lerp8(0, 200, PROGRESS_ONE / 2));
+  TEST_ASSERT_TRUE(lerpColor(CRGB(0, 0, 0), CRGB(200, 100, 50), 999, 1000) != CRGB(200, 100, 50));
+  TEST_ASSERT_TRUE(lerpColor(CRGB(0, 0, 0), CRGB(200, 100, 50), 1000, 1000) == CRGB(200, 100, 50));
+}
+
+// どのカーブも 0 から始まり、1.0 の手前で 1.0 近くに達し、途中で戻らない
+void test_curves_are_bounded_and_monotonic() {
+  for (uint8_t easing = EASE_IN_QUAD; easing < EASING_COUNT; easing++) {
+    TEST_ASSERT_EQUAL_UINT32(0, applyEasing(easing, 0));
+    uint32_t end = applyEasing(easing, PROGRESS_ONE - 1);
+    TEST_ASSERT_LESS_THAN_UINT32(PROGRESS_ONE, end);
+    TEST_ASSERT_GREATER_THAN_UINT32(PROGRESS_ONE * 9 / 10, end);
+
+    uint32_t previous = 0;
+    for (uint32_t progress = 0; progress < PROGRESS_ONE; progress += 64) {
+      uint32_t value = applyEasing(easing, progress);
+      TEST_ASSERT_LESS_THAN_UINT32(PROGRESS_ONE, value);
+      TEST_ASSERT_GREATER_OR_EQUAL_UINT32(previous, value);
+      previous = value;
+    }
+  }
+}
+
+void test_linear_and_step() {
+  TEST_ASSERT_EQUAL_UINT32(0, applyEasing(EASE_LINEAR, 0));
+  TEST_ASSERT_EQUAL_UINT32(12345, applyEasing(EASE_LINEAR, 12345));
+  TEST_ASSERT_EQUAL_UINT32(PROGRESS_ONE - 1, applyEasing(EASE_LINEAR, PROGRESS_ONE - 1));
+  // 終点までは開始値のまま（終点では easeColor() が to を返す）
+  TEST_ASSERT_EQUAL_UINT32(0, applyEasing(EASE_STEP, PROGRESS_ONE - 1));
+  TEST_ASSERT_TRUE(easeColor(CRGB(1, 2, 3), CRGB(9, 9, 9), 999, 1000, EASE_STEP) == CRGB(1, 2, 3));
+}
+
+// 1.0 以上の進行度は 1.0 未満の最大値として扱い、範囲外のイージングは線形
+void test_out_of_range_inputs_are_clamped() {
+  for (uint8_t easing = 0; easing < EASING_COUNT; easing++) {
+    TEST_ASSERT_EQUAL_UINT32(applyEasing(easing, PROGRESS_ONE - 1), applyEasing(easing, PROGRESS_ONE));
+    TEST_ASSERT_EQUAL_UINT32(applyEasing(easing, PROGRESS_ONE - 1), applyEasing(easing, UINT32_MAX));
+  }
+  TEST_ASSERT_EQUAL_UINT32(1000, applyEasing(EASING_COUNT, 1000));
+  TEST_ASSERT_EQUAL_UINT32(PROGRESS_ONE - 1, applyEasing(255, PROGRESS_ONE));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_progress_stays_below_one);
+  RUN_TEST(test_progress_midpoint);
+  RUN_TEST(test_progress_is_monotonic_for_long_durations);
+  RUN_TEST(test_zero_duration_jumps_to_target);
+  RUN_TEST(test_lerp_endpoints);
+  RUN_TEST(test_curves_are_bounded_and_monotonic);
+  RUN_TEST(test_linear_and_step);
+  RUN_TEST(test_out_of_range_inputs_are_clamped);
+  return UNITY_END();
+}
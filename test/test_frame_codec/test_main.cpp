@@ -0,0 +1,168 @@
+// 差分ピクセルフレーム（frame_codec.h）の書き出しと適用のテスト
+// encodeDeltaFrame の出力を applyDeltaFrame で前フレームに適用すると次フレームに一致すること
+//   pio test -e native -f test_frame_codec
+
+#include <unity.h>
+#include <string.h>
+
+#include "frame_codec.h"
+
+void setUp() {}
+void tearDown() {}
+
+// 差分データの最大長（全画素がリテラルでも収まる）
+#define DELTA_BUFFER_SIZE (DELTA_MAX_PIXELS * 3 + (DELTA_MAX_PIXELS / DELTA_COUNT_MAX + 1) * 2)
+
+// prev → next を書き出して prev の複製に適用し、next と一致するか確かめる（書き出したバイト数を返す）
+static size_t roundTrip(const CRGB* prev, const CRGB* next, size_t numPixels) {
+  static uint8_t delta[DELTA_BUFFER_SIZE];
+  static CRGB pixels[DELTA_MAX_PIXELS];
+  size_t written = 0;
+  TEST_ASSERT_TRUE(encodeDeltaFrame(prev, next, numPixels, delta, sizeof(delta), written));
+  memcpy(pixels, prev, numPixels * sizeof(CRGB));
+  TEST_ASSERT_TRUE(applyDeltaFrame(delta, written, pixels, numPixels));
+  TEST_ASSERT_EQUAL_MEMORY(next, pixels, numPixels * sizeof(CRGB));
+  return written;
+}
+
+// 再現できる擬似乱数（線形合同法）
+static uint32_t nextRandom(uint32_t& state) {
+  state = state * 1664525u + 1013904223u;
+  return state >> 8;
+}
+
+void test_unchanged_frame_is_empty() {
+  CRGB frame[48];
+  for (size_t i = 0; i < 48; i++) {
+    frame[i] = CRGB(i, 255 - i, 7);
+  }
+  TEST_ASSERT_EQUAL(0, roundTrip(frame, frame, 48));
+}
+
+void test_single_pixel() {
+  CRGB prev[48] = {};
+  CRGB next[48] = {};
+  next[47] = CRGB(1, 2, 3);
+  // [START][COUNT] R,G,B の1スパン
+  TEST_ASSERT_EQUAL(5, roundTrip(prev, next, 48));
+}
+
+void test_full_fill_uses_runs() {
+  static CRGB prev[DELTA_MAX_PIXELS] = {};
+  static CRGB next[DELTA_MAX_PIXELS];
+  for (size_t i = 0; i < DELTA_MAX_PIXELS; i++) {
+    next[i] = CRGB(255, 0, 64);
+  }
+  // 127 + 127 + 2 画素: ラン2つと残り2画素のリテラル
+  size_t written = roundTrip(prev, next, DELTA_MAX_PIXELS);
+  TEST_ASSERT_LESS_THAN(DELTA_MAX_PIXELS, written);
+}
+
+void test_chase_frames() {
+  static CRGB prev[DELTA_MAX_PIXELS];
+  static CRGB next[DELTA_MAX_PIXELS];
+  for (size_t step = 0; step < 40; step++) {
+    for (size_t i = 0; i < DELTA_MAX_PIXELS; i++) {
+      prev[i] = (i % 40) == step ? CRGB(255, 255, 255) : CRGB(0, 0, 16);
+      next[i] = (i % 40) == (step + 1) % 40 ? CRGB(255, 255, 255) : CRGB(0, 0, 16);
+    }
+    roundTrip(prev, next, DELTA_MAX_PIXELS);
+  }
+}
+
+void test_gradient_and_random_frames() {
+  static CRGB prev[DELTA_MAX_PIXELS];
+  static CRGB next[DELTA_MAX_PIXELS];
+  for (size_t i = 0; i < DELTA_MAX_PIXELS; i++) {
+    prev[i] = CRGB(0, 0, 0);
+    next[i] = CRGB(i, i / 2, 255 - i);
+  }
+  roundTrip(prev, next, DELTA_MAX_PIXELS);
+
+  uint32_t state = 12345;
+  for (size_t i = 0; i < DELTA_MAX_PIXELS; i++) {
+    prev[i] = CRGB(nextRandom(state), nextRandom(state), nextRandom(state));
+  }
+  for (int frame = 0; frame < 200; frame++) {
+    // 一部の画素だけ変え、同じ色が続く区間も混ぜる
+    memcpy(next, prev, sizeof(next));
+    size_t changes = nextRandom(state) % 64;
+    for (size_t c = 0; c < changes; c++) {
+      size_t at = nextRandom(state) % DELTA_MAX_PIXELS;
+      size_t len = 1 + nextRandom(state) % 8;
+      CRGB color(nextRandom(state) % 4, nextRandom(state), 0);
+      for (size_t i = at; i < at + len && i < DELTA_MAX_PIXELS; i++) {
+        next[i] = (nextRandom(state) & 1) ? color : CRGB(nextRandom(state), 1, 2);
+      }
+    }
+    size_t numPixels = frame % 2 ? DELTA_MAX_PIXELS : 48;
+    roundTrip(prev, next, numPixels);
+    memcpy(prev, next, sizeof(prev));
+  }
+}
+
+// START は1バイトなので 256 画素を超えるストリップは書き出さない
+void test_encode_rejects_more_than_max_pixels() {
+  static CRGB prev[DELTA_MAX_PIXELS + 1] = {};
+  static CRGB next[DELTA_MAX_PIXELS + 1] = {};
+  next[DELTA_MAX_PIXELS] = CRGB(1, 1, 1);
+  static uint8_t delta[DELTA_BUFFER_SIZE];
+  size_t written = 0;
+  TEST_ASSERT_FALSE(encodeDeltaFrame(prev, next, DELTA_MAX_PIXELS + 1, delta, sizeof(delta), written));
+}
+
+void test_encode_rejects_small_buffer() {
+  CRGB prev[8] = {};
+  CRGB next[8] = {};
+  next[0] = CRGB(1, 0, 0);
+  next[4] = CRGB(0, 1, 0);
+  // 1画素のスパン2つで10バイト
+  uint8_t delta[10];
+  size_t written = 0;
+  TEST_ASSERT_FALSE(encodeDeltaFrame(prev, next, 8, delta, 9, written));
+  TEST_ASSERT_TRUE(encodeDeltaFrame(prev, next, 8, delta, sizeof(delta), written));
+  TEST_ASSERT_EQUAL(10, written);
+}
+
+// 不正なスパンが1つでもあれば画素には一切触れない
+void test_apply_rejects_malformed_spans() {
+  CRGB pixels[8];
+  CRGB before[8];
+  for (size_t i = 0; i < 8; i++) {
+    pixels[i] = CRGB(i, i, i);
+  }
+  memcpy(before, pixels, sizeof(pixels));
+
+  const uint8_t zeroCount[] = { 0, 1, 9, 9, 9, 2, 0 };
+  const uint8_t pastEnd[] = { 0, 1, 9, 9, 9, 6, 3, 1, 1, 1, 2, 2, 2, 3, 3, 3 };
+  const uint8_t runPastEnd[] = { 7, DELTA_RUN_FLAG | 2, 1, 2, 3 };
+  const uint8_t truncated[] = { 0, 1, 9, 9, 9, 2, 2, 1, 1, 1, 2 };
+  const uint8_t headerOnly[] = { 0, 1, 9, 9, 9, 3 };
+  TEST_ASSERT_FALSE(applyDeltaFrame(zeroCount, sizeof(zeroCount), pixels, 8));
+  TEST_ASSERT_FALSE(applyDeltaFrame(pastEnd, sizeof(pastEnd), pixels, 8));
+  TEST_ASSERT_FALSE(applyDeltaFrame(runPastEnd, sizeof(runPastEnd), pixels, 8));
+  TEST_ASSERT_FALSE(applyDeltaFrame(truncated, sizeof(truncated), pixels, 8));
+  TEST_ASSERT_FALSE(applyDeltaFrame(headerOnly, sizeof(headerOnly), pixels, 8));
+  TEST_ASSERT_FALSE(checkDeltaFrame(pastEnd, sizeof(pastEnd), 8));
+  TEST_ASSERT_TRUE(checkDeltaFrame(pastEnd, sizeof(pastEnd), 9));
+  TEST_ASSERT_EQUAL_MEMORY(before, pixels, sizeof(pixels));
+
+  const uint8_t run[] = { 5, DELTA_RUN_FLAG | 3, 1, 2, 3 };
+  TEST_ASSERT_TRUE(applyDeltaFrame(run, sizeof(run), pixels, 8));
+  TEST_ASSERT_TRUE(pixels[4] == before[4]);
+  TEST_ASSERT_TRUE(pixels[5] == CRGB(1, 2, 3));
+  TEST_ASSERT_TRUE(pixels[7] == CRGB(1, 2, 3));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_unchanged_frame_is_empty);
+  RUN_TEST(test_single_pixel);
+  RUN_TEST(test_full_fill_uses_runs);
+  RUN_TEST(test_chase_frames);
+  RUN_TEST(test_gradient_and_random_frames);
+  RUN_TEST(test_encode_rejects_more_than_max_pixels);
+  RUN_TEST(test_encode_rejects_small_buffer);
+  RUN_TEST(test_apply_rejects_malformed_spans);
+  return UNITY_END();
+}
@@ -0,0 +1,228 @@
+// FrameEngine（実機の loop() とシミュレータが共有する1フレームの処理）のテスト
+//   pio test -e native -f test_frame_engine
+
+#include <unity.h>
+#include <string.h>
+
+#include "frame_engine.h"
+#include "led_strip.h"
+#include "xy_map.h"
+
+using TestStrip = LedStrip<StripLayout<4, 12>>;
+using TestMap = XyMap<TestStrip::layout, XY_ROW_MAJOR>;
+using TestEngine = FrameEngine<TestStrip, TestMap>;
+
+// 仮想時計の FramePlatform（送信と応答は数えるだけ）
+class TestPlatform : public FramePlatform {
+public:
+  uint32_t nowMs() override { return nowUs_ / 1000; }
+  uint32_t nowUs() override { return nowUs_; }
+  uint8_t brightness() override { return 255; }
+  void show() override { showCount++; }
+  void sendStatsReport(uint8_t, uint8_t) override { statsCount++; }
+  void sendTimeReply(const Command&) override { pingCount++; }
+
+  void advanceMs(uint32_t ms) { nowUs_ += ms * 1000; }
+
+  uint32_t nowUs_ = 0;
+  int showCount = 0;
+  int statsCount = 0;
+  int pingCount = 0;
+};
+
+static TestEngine* engine;
+static TestPlatform* platform;
+
+void setUp() {
+  engine = new TestEngine();
+  platform = new TestPlatform();
+}
+
+void tearDown() {
+  delete engine;
+  delete platform;
+}
+
+static ParseResult writeAscii(const char* text) {
+  return engine->receiveHostWrite((const uint8_t*)text, strlen(text), platform->nowUs(), platform->nowMs());
+}
+
+static ParseResult writeBinary(const uint8_t* data, size_t len) {
+  return engine->receiveHostWrite(data, len, platform->nowUs(), platform->nowMs());
+}
+
+static void assertAllPixels(uint8_t r, uint8_t g, uint8_t b) {
+  const CRGB* leds = engine->leds().pixels();
+  for (size_t i = 0; i < TestStrip::SIZE; i++) {
+    TEST_ASSERT_EQUAL_UINT8(r, leds[i].r);
+    TEST_ASSERT_EQUAL_UINT8(g, leds[i].g);
+    TEST_ASSERT_EQUAL_UINT8(b, leds[i].b);
+  }
+}
+
+void test_color_write_is_shown_on_the_next_frame() {
+  TEST_ASSERT_EQUAL(PARSE_OK, writeAscii("C:255,0,0"));
+  TEST_ASSERT_TRUE(engine->runFrame(*platform));
+  TEST_ASSERT_EQUAL(1, platform->showCount);
+  TEST_ASSERT_EQUAL(MODE_FIXED, engine->controller().mode());
+  assertAllPixels(255, 0, 0);
+}
+
+void test_unchanged_frame_is_skipped_until_keepalive() {
+  writeAscii("C:0,0,255");
+  engine->runFrame(*platform);
+
+  platform->advanceMs(16);
+  TEST_ASSERT_FALSE(engine->runFrame(*platform));
+  TEST_ASSERT_EQUAL(1, platform->showCount);
+
+  platform->advanceMs(SHOW_KEEPALIVE_MS);
+  TEST_ASSERT_TRUE(engine->runFrame(*platform));
+  TEST_ASSERT_EQUAL(2, platform->showCount);
+}
+
+void test_batch_is_applied_in_one_frame() {
+  TEST_ASSERT_EQUAL(PARSE_OK, writeAscii("C:255,0,0\nC:0,255,0"));
+  engine->runFrame(*platform);
+  assertAllPixels(0, 255, 0);
+  TEST_ASSERT_EQUAL(1, platform->showCount);
+}
+
+// OP_TIME_SET で共有時計 = millis() + offset にする
+static void setClock(uint32_t offset) {
+  const uint8_t set[] = { PROTOCOL_MAGIC, OP_TIME_SET, (uint8_t)offset, (uint8_t)(offset >> 8),
+                          (uint8_t)(offset >> 16), (uint8_t)(offset >> 24) };
+  TEST_ASSERT_EQUAL(PARSE_OK, writeBinary(set, sizeof(set)));
+}
+
+// OP_AT（TIME=startAt）で OP_HUE を予約する
+static void writeAtHue(uint32_t startAt, uint8_t hue) {
+  const uint8_t at[] = { PROTOCOL_MAGIC, OP_AT, 6, (uint8_t)startAt, (uint8_t)(startAt >> 8),
+                         (uint8_t)(startAt >> 16), (uint8_t)(startAt >> 24), OP_HUE, hue };
+  TEST_ASSERT_EQUAL(PARSE_OK, writeBinary(at, sizeof(at)));
+}
+
+void test_scheduled_command_starts_at_its_time() {
+  setClock(0);
+  // OP_AT: TIME=100ms, OP_COLOR 255,0,0
+  const uint8_t at[] = { PROTOCOL_MAGIC, OP_AT, 8, 100, 0, 0, 0, OP_COLOR, 255, 0, 0 };
+  TEST_ASSERT_EQUAL(PARSE_OK, writeBinary(at, sizeof(at)));
+
+  platform->advanceMs(50);
+  engine->runFrame(*platform);
+  TEST_ASSERT_EQUAL(MODE_AUTO, engine->controller().mode());
+  TEST_ASSERT_EQUAL(1, (int)engine->scheduler().pending());
+
+  platform->advanceMs(50);
+  engine->runFrame(*platform);
+  TEST_ASSERT_EQUAL(MODE_FIXED, engine->controller().mode());
+  TEST_ASSERT_EQUAL(0, (int)engine->scheduler().pending());
+  assertAllPixels(255, 0, 0);
+}
+
+// 共有時計を設定する前の OP_AT は、どの時計の時刻か分からないので予約しない
+void test_schedule_is_refused_until_the_clock_is_set() {
+  writeAtHue(100, 10);
+  engine->runFrame(*platform);
+  TEST_ASSERT_EQUAL(0, (int)engine->scheduler().pending());
+
+  setClock(5000);
+  writeAtHue(5100, 10);
+  engine->runFrame(*platform);
+  TEST_ASSERT_EQUAL(1, (int)engine->scheduler().pending());
+}
+
+// SCHEDULE_AHEAD_MAX_MS より先の開始時刻は予約の枠を塞がないよう拒否する
+void test_far_future_start_is_refused() {
+  setClock(0);
+  platform->advanceMs(1000);
+  writeAtHue(1000 + SCHEDULE_AHEAD_MAX_MS + 1, 10);
+  engine->runFrame(*platform);
+  TEST_ASSERT_EQUAL(0, (int)engine->scheduler().pending());
+
+  writeAtHue(1000 + SCHEDULE_AHEAD_MAX_MS, 10);
+  engine->runFrame(*platform);
+  TEST_ASSERT_EQUAL(1, (int)engine->scheduler().pending());
+}
+
+// 予約が満杯なら後の予約は捨てるが、すぐに反映するコマンドや OP_TIME_SET で空く
+void test_full_scheduler_is_released() {
+  setClock(0);
+  for (size_t i = 0; i < SCHEDULED_COMMAND_MAX; i++) {
+    writeAtHue(30000, (uint8_t)i);
+  }
+  engine->runFrame(*platform);
+  TEST_ASSERT_EQUAL(SCHEDULED_COMMAND_MAX, (int)engine->scheduler().pending());
+
+  writeAtHue(100, 99);
+  engine->runFrame(*platform);
+  TEST_ASSERT_EQUAL(SCHEDULED_COMMAND_MAX, (int)engine->scheduler().pending());
+
+  // すぐに反映する色は前の予約を取り消す
+  writeAscii("C:0,0,255");
+  engine->runFrame(*platform);
+  TEST_ASSERT_EQUAL(0, (int)engine->scheduler().pending());
+  assertAllPixels(0, 0, 255);
+
+  // 同じ書き込みの予約は取り消さない
+  const uint8_t batch[] = { PROTOCOL_MAGIC, OP_COLOR, 255, 0, 0, OP_AT, 6, 100, 0, 0, 0, OP_HUE, 7 };
+  TEST_ASSERT_EQUAL(PARSE_OK, writeBinary(batch, sizeof(batch)));
+  engine->runFrame(*platform);
+  TEST_ASSERT_EQUAL(1, (int)engine->scheduler().pending());
+
+  // 共有時計を設定し直すと古い開始時刻の予約は取り消す
+  setClock(123);
+  engine->runFrame(*platform);
+  TEST_ASSERT_EQUAL(0, (int)engine->scheduler().pending());
+}
+
+void test_stats_and_ping_are_answered_by_the_platform() {
+  const uint8_t batch[] = { PROTOCOL_MAGIC, OP_STATS_REQUEST, STATS_REPORT_LATENCY, 0, OP_TIME_PING, 1, 2, 3, 4 };
+  TEST_ASSERT_EQUAL(PARSE_OK, writeBinary(batch, sizeof(batch)));
+  engine->runFrame(*platform);
+  TEST_ASSERT_EQUAL(1, platform->statsCount);
+  TEST_ASSERT_EQUAL(1, platform->pingCount);
+}
+
+void test_frame_rate_follows_the_mode() {
+  uint32_t start = engine->finishFrame(platform->nowUs());
+  TEST_ASSERT_EQUAL_UINT32(1000000u / MODE_FRAME_RATE[MODE_AUTO], start);
+
+  writeAscii("C:255,0,0");
+  engine->runFrame(*platform);
+  uint32_t next = engine->finishFrame(platform->nowUs());
+  TEST_ASSERT_EQUAL_UINT32(start + 1000000u / MODE_FRAME_RATE[MODE_FIXED], next);
+
+  engine->setFixedFps(60);
+  TEST_ASSERT_EQUAL_UINT32(next + 1000000u / 60, engine->finishFrame(platform->nowUs()));
+}
+
+void test_latency_is_recorded_only_for_shown_frames() {
+  writeAscii("C:255,0,0");
+  platform->advanceMs(5);
+  engine->runFrame(*platform);
+  TEST_ASSERT_EQUAL_UINT32(1, engine->latencyTotal().count());
+  TEST_ASSERT_EQUAL_UINT32(1, engine->latencyQueue().count());
+
+  // 同じ色なので送らない
+  writeAscii("C:255,0,0");
+  platform->advanceMs(16);
+  TEST_ASSERT_FALSE(engine->runFrame(*platform));
+  TEST_ASSERT_EQUAL_UINT32(1, engine->latencyTotal().count());
+  TEST_ASSERT_EQUAL_UINT32(2, engine->latencyQueue().count());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_color_write_is_shown_on_the_next_frame);
+  RUN_TEST(test_unchanged_frame_is_skipped_until_keepalive);
+  RUN_TEST(test_batch_is_applied_in_one_frame);
+  RUN_TEST(test_scheduled_command_starts_at_its_time);
+  RUN_TEST(test_schedule_is_refused_until_the_clock_is_set);
+  RUN_TEST(test_far_future_start_is_refused);
+  RUN_TEST(test_full_scheduler_is_released);
+  RUN_TEST(test_stats_and_ping_are_answered_by_the_platform);
+  RUN_TEST(test_frame_rate_follows_the_mode);
+  RUN_TEST(test_latency_is_recorded_only_for_shown_frames);
+  return UNITY_END();
+}
@@ -0,0 +1,165 @@
+// リプレイログ（replay_log.h）のリングバッファと、取り出したログの読み出しのテスト
+//   pio test -e native -f test_replay_log
+
+#include <unity.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+
+#include "replay_log.h"
+
+void setUp() {}
+void tearDown() {}
+
+struct Record {
+  uint32_t arrivalUs;
+  std::vector<uint8_t> data;
+};
+
+// snapshot() を取り、nextReplayRecord() で読んだ記録が expected と一致するか確かめる
+template <size_t N>
+static void assertLogHolds(const ReplayLog<N>& log, const std::deque<Record>& expected) {
+  uint8_t out[N];
+  size_t logLen = log.snapshot(out, sizeof(out));
+  size_t offset = 0;
+  uint32_t arrivalUs;
+  const uint8_t* data;
+  size_t len;
+  for (const Record& record : expected) {
+    TEST_ASSERT_TRUE(nextReplayRecord(out, logLen, offset, arrivalUs, data, len));
+    TEST_ASSERT_EQUAL_UINT32(record.arrivalUs, arrivalUs);
+    TEST_ASSERT_EQUAL(record.data.size(), len);
+    if (len > 0) {
+      TEST_ASSERT_EQUAL_MEMORY(record.data.data(), data, len);
+    }
+  }
+  TEST_ASSERT_EQUAL(logLen, offset);
+  TEST_ASSERT_FALSE(nextReplayRecord(out, logLen, offset, arrivalUs, data, len));
+}
+
+void test_records_are_read_back_in_order() {
+  ReplayLog<64> log;
+  std::deque<Record> expected;
+  uint8_t empty[1];
+  TEST_ASSERT_EQUAL(0, log.snapshot(empty, sizeof(empty)));
+
+  const uint8_t a[] = { 'C', ':', '1' };
+  const uint8_t b[] = { 0xA5, 0x01, 1, 2, 3 };
+  TEST_ASSERT_TRUE(log.record(100, a, sizeof(a)));
+  TEST_ASSERT_TRUE(log.record(0xDEADBEEF, b, sizeof(b)));
+  TEST_ASSERT_TRUE(log.record(300, nullptr, 0));
+  expected.push_back({ 100, std::vector<uint8_t>(a, a + sizeof(a)) });
+  expected.push_back({ 0xDEADBEEF, std::vector<uint8_t>(b, b + sizeof(b)) });
+  expected.push_back({ 300, {} });
+  assertLogHolds(log, expected);
+  TEST_ASSERT_EQUAL_UINT32(3, log.recordedCount());
+}
+
+// 満杯になったら最も古い記録から捨てる
+void test_oldest_record_is_evicted() {
+  ReplayLog<32> log;
+  std::deque<Record> expected;
+  for (uint32_t i = 0; i < 4; i++) {
+    const uint8_t data[] = { (uint8_t)i, (uint8_t)i, (uint8_t)i, (uint8_t)i };
+    TEST_ASSERT_TRUE(log.record(i, data, sizeof(data)));
+    expected.push_back({ i, std::vector<uint8_t>(data, data + sizeof(data)) });
+  }
+  // 10バイトの記録は3件まで
+  expected.pop_front();
+  assertLogHolds(log, expected);
+  TEST_ASSERT_EQUAL_UINT32(4, log.recordedCount());
+
+  // 大きい記録は古い記録を複数捨てる
+  const uint8_t big[20] = { 9 };
+  TEST_ASSERT_TRUE(log.record(99, big, sizeof(big)));
+  expected.clear();
+  expected.push_back({ 99, std::vector<uint8_t>(big, big + sizeof(big)) });
+  assertLogHolds(log, expected);
+}
+
+// 大きさの違う記録でリングを何周もさせても、直近の収まる分だけが壊れずに残る
+void test_wrap_with_mixed_record_sizes() {
+  ReplayLog<64> log;
+  std::deque<Record> expected;
+  size_t bytes = 0;
+  uint32_t state = 1;
+  for (uint32_t i = 0; i < 500; i++) {
+    state = state * 1103515245u + 12345u;
+    size_t len = (state >> 16) % 30;
+    Record record = { i * 1000 + 7, std::vector<uint8_t>(len) };
+    for (size_t k = 0; k < len; k++) {
+      record.data[k] = (uint8_t)(i + k);
+    }
+    TEST_ASSERT_TRUE(log.record(record.arrivalUs, record.data.data(), len));
+    bytes += REPLAY_RECORD_HEADER + len;
+    expected.push_back(record);
+    while (bytes > 64) {
+      bytes -= REPLAY_RECORD_HEADER + expected.front().data.size();
+      expected.pop_front();
+    }
+    assertLogHolds(log, expected);
+  }
+  TEST_ASSERT_EQUAL_UINT32(500, log.recordedCount());
+}
+
+// N に収まらない書き込みは記録せず、残っている記録も消さない
+void test_oversized_write_is_not_recorded() {
+  ReplayLog<32> log;
+  const uint8_t small[] = { 1, 2 };
+  log.record(1, small, sizeof(small));
+  const uint8_t big[32 - REPLAY_RECORD_HEADER + 1] = {};
+  TEST_ASSERT_FALSE(log.record(2, big, sizeof(big)));
+  TEST_ASSERT_TRUE(log.record(3, big, sizeof(big) - 1)); // ちょうど N バイト
+  std::deque<Record> expected;
+  expected.push_back({ 3, std::vector<uint8_t>(big, big + sizeof(big) - 1) });
+  assertLogHolds(log, expected);
+  TEST_ASSERT_EQUAL_UINT32(2, log.recordedCount());
+
+  // 取り出し先が小さければ 0
+  uint8_t out[16];
+  TEST_ASSERT_EQUAL(0, log.snapshot(out, sizeof(out)));
+}
+
+// 途中で切れた・長さが壊れた記録は読まずに false（offset は進めない）
+void test_truncated_or_corrupt_record_is_rejected() {
+  const uint8_t log[] = {
+    0x10, 0, 0, 0, 3, 0, 'H', ':', '1',   // 1件目（9バイト）
+    0x20, 0, 0, 0, 4, 0, 'M', ':', '0',   // 2件目: 長さ4だがデータは3バイト
+  };
+  size_t offset = 0;
+  uint32_t arrivalUs;
+  const uint8_t* data;
+  size_t len;
+  TEST_ASSERT_TRUE(nextReplayRecord(log, sizeof(log), offset, arrivalUs, data, len));
+  TEST_ASSERT_EQUAL_UINT32(0x10, arrivalUs);
+  TEST_ASSERT_EQUAL(3, len);
+  TEST_ASSERT_EQUAL(9, offset);
+
+  TEST_ASSERT_FALSE(nextReplayRecord(log, sizeof(log), offset, arrivalUs, data, len));
+  TEST_ASSERT_EQUAL(9, offset);
+
+  // ヘッダの途中で切れている
+  offset = 0;
+  TEST_ASSERT_FALSE(nextReplayRecord(log, REPLAY_RECORD_HEADER - 1, offset, arrivalUs, data, len));
+  // データの途中で切れている
+  TEST_ASSERT_FALSE(nextReplayRecord(log, 8, offset, arrivalUs, data, len));
+  TEST_ASSERT_EQUAL(0, offset);
+  // offset がログの外
+  offset = sizeof(log) + 1;
+  TEST_ASSERT_FALSE(nextReplayRecord(log, sizeof(log), offset, arrivalUs, data, len));
+
+  // 長さが 0xFFFF に壊れていても範囲外を読まない
+  const uint8_t corrupt[] = { 0, 0, 0, 0, 0xFF, 0xFF, 1, 2, 3 };
+  offset = 0;
+  TEST_ASSERT_FALSE(nextReplayRecord(corrupt, sizeof(corrupt), offset, arrivalUs, data, len));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_records_are_read_back_in_order);
+  RUN_TEST(test_oldest_record_is_evicted);
+  RUN_TEST(test_wrap_with_mixed_record_sizes);
+  RUN_TEST(test_oversized_write_is_not_recorded);
+  RUN_TEST(test_truncated_or_corrupt_record_is_rejected);
+  return UNITY_END();
+}
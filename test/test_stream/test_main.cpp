@@ -0,0 +1,101 @@
+// ストリーム（stream.h）の SEQ の分割と、抜け・遅れの数え方のテスト
+//   pio test -e native -f test_stream
+
+#include <unity.h>
+
+#include "stream.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void assertCounts(const StreamSequence& sequence, uint32_t received, uint32_t lost,
+                         uint32_t stale, uint16_t lastSeq) {
+  TEST_ASSERT_EQUAL_UINT32(received, sequence.receivedCount());
+  TEST_ASSERT_EQUAL_UINT32(lost, sequence.lostCount());
+  TEST_ASSERT_EQUAL_UINT32(stale, sequence.staleCount());
+  TEST_ASSERT_EQUAL_HEX16(lastSeq, sequence.lastSeq());
+}
+
+void test_stream_write_is_split_into_seq_and_write() {
+  StreamWrite out;
+  const uint8_t data[] = { 0x34, 0x12, 'M', ':', '1' };
+  TEST_ASSERT_EQUAL(PARSE_OK, parseStreamWrite(data, sizeof(data), out));
+  TEST_ASSERT_EQUAL_HEX16(0x1234, out.seq);
+  TEST_ASSERT_EQUAL_PTR(data + STREAM_HEADER, out.write);
+  TEST_ASSERT_EQUAL(3, out.writeLen);
+
+  // SEQ だけで中身がないものは受け付けない
+  TEST_ASSERT_EQUAL(PARSE_EMPTY, parseStreamWrite(data, 0, out));
+  TEST_ASSERT_EQUAL(PARSE_TRUNCATED, parseStreamWrite(data, 1, out));
+  TEST_ASSERT_EQUAL(PARSE_TRUNCATED, parseStreamWrite(data, STREAM_HEADER, out));
+}
+
+void test_gaps_and_late_writes_are_counted() {
+  StreamSequence sequence;
+  assertCounts(sequence, 0, 0, 0, 0);
+
+  TEST_ASSERT_TRUE(sequence.accept(0));
+  assertCounts(sequence, 1, 0, 0, 0);
+  TEST_ASSERT_TRUE(sequence.accept(1));
+  assertCounts(sequence, 2, 0, 0, 1);
+  // 2,3 が抜けた
+  TEST_ASSERT_TRUE(sequence.accept(4));
+  assertCounts(sequence, 3, 2, 0, 4);
+  // 遅れて届いた 2 と重複した 4 は捨てる（抜けの数は戻さない）
+  TEST_ASSERT_FALSE(sequence.accept(2));
+  assertCounts(sequence, 3, 2, 1, 4);
+  TEST_ASSERT_FALSE(sequence.accept(4));
+  assertCounts(sequence, 3, 2, 2, 4);
+  TEST_ASSERT_TRUE(sequence.accept(5));
+  assertCounts(sequence, 4, 2, 2, 5);
+  // 0xfff0 は 6 から 22 戻った（窓の中）ので古い書き込みとして捨てる
+  TEST_ASSERT_FALSE(sequence.accept(0xfff0));
+  assertCounts(sequence, 4, 2, 3, 5);
+}
+
+void test_seq_wraps_from_0xffff_to_0() {
+  StreamSequence sequence;
+  TEST_ASSERT_TRUE(sequence.accept(0xfffe));
+  TEST_ASSERT_TRUE(sequence.accept(0xffff));
+  TEST_ASSERT_TRUE(sequence.accept(0));
+  TEST_ASSERT_TRUE(sequence.accept(1));
+  assertCounts(sequence, 4, 0, 0, 1);
+
+  // 折り返しをまたいだ抜けと遅れ
+  TEST_ASSERT_TRUE(sequence.accept(5)); // 2,3,4 が抜けた
+  assertCounts(sequence, 5, 3, 0, 5);
+  TEST_ASSERT_FALSE(sequence.accept(0xffff));
+  assertCounts(sequence, 5, 3, 1, 5);
+}
+
+void test_reconnect_restarts_at_0() {
+  // 接続し直したら reset() で数え直す
+  StreamSequence sequence;
+  for (uint16_t seq = 100; seq < 110; seq++) {
+    TEST_ASSERT_TRUE(sequence.accept(seq));
+  }
+  sequence.reset();
+  assertCounts(sequence, 0, 0, 0, 0);
+  TEST_ASSERT_TRUE(sequence.accept(0));
+  TEST_ASSERT_TRUE(sequence.accept(1));
+  assertCounts(sequence, 2, 0, 0, 1);
+
+  // reset() なしでホストが 0 から数え直しても、窓より大きく戻ったので受け付ける
+  StreamSequence restarted;
+  for (uint16_t seq = 100; seq < 110; seq++) {
+    TEST_ASSERT_TRUE(restarted.accept(seq));
+  }
+  TEST_ASSERT_TRUE(restarted.accept(0));
+  assertCounts(restarted, 11, 0, 0, 0);
+  TEST_ASSERT_TRUE(restarted.accept(1));
+  assertCounts(restarted, 12, 0, 0, 1);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_stream_write_is_split_into_seq_and_write);
+  RUN_TEST(test_gaps_and_late_writes_are_counted);
+  RUN_TEST(test_seq_wraps_from_0xffff_to_0);
+  RUN_TEST(test_reconnect_restarts_at_0);
+  return UNITY_END();
+}
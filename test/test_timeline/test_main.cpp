@@ -0,0 +1,142 @@
+// キーフレームタイムライン（timeline.h）の追加と再生のテスト
+//   pio test -e native -f test_timeline
+
+#include <unity.h>
+
+#include "easing.h"
+#include "timeline.h"
+
+void setUp() {}
+void tearDown() {}
+
+static Keyframe key(uint32_t time, uint8_t r, uint8_t g, uint8_t b, uint8_t easing = EASE_LINEAR) {
+  Keyframe keyframe;
+  keyframe.time = time;
+  keyframe.color = CRGB(r, g, b);
+  keyframe.easing = easing;
+  return keyframe;
+}
+
+static void assertColor(uint8_t r, uint8_t g, uint8_t b, const CRGB& color) {
+  TEST_ASSERT_EQUAL_UINT8(r, color.r);
+  TEST_ASSERT_EQUAL_UINT8(g, color.g);
+  TEST_ASSERT_EQUAL_UINT8(b, color.b);
+}
+
+void test_append_rejects_out_of_order_and_full() {
+  Timeline timeline;
+  TEST_ASSERT_TRUE(timeline.append(key(100, 0, 0, 0)));
+  TEST_ASSERT_TRUE(timeline.append(key(100, 1, 1, 1))); // 同じ時刻は許す
+  TEST_ASSERT_FALSE(timeline.append(key(99, 2, 2, 2)));
+  TEST_ASSERT_EQUAL(2, timeline.size());
+
+  timeline.clear();
+  for (uint32_t i = 0; i < TIMELINE_MAX_KEYFRAMES; i++) {
+    TEST_ASSERT_TRUE(timeline.append(key(i * 10, 0, 0, 0)));
+  }
+  TEST_ASSERT_FALSE(timeline.append(key(TIMELINE_MAX_KEYFRAMES * 10, 0, 0, 0)));
+  TEST_ASSERT_EQUAL(TIMELINE_MAX_KEYFRAMES, timeline.size());
+}
+
+void test_play_needs_keyframes() {
+  Timeline timeline;
+  TEST_ASSERT_FALSE(timeline.play(0, false));
+  TEST_ASSERT_FALSE(timeline.playing());
+}
+
+void test_linear_interpolation_and_stop_at_end() {
+  Timeline timeline;
+  timeline.append(key(0, 0, 0, 0));
+  timeline.append(key(1000, 200, 100, 0));
+  timeline.append(key(2000, 200, 100, 200));
+  TEST_ASSERT_TRUE(timeline.play(5000, false));
+
+  assertColor(0, 0, 0, timeline.render(5000));
+  assertColor(100, 50, 0, timeline.render(5500));
+  assertColor(200, 100, 0, timeline.render(6000));
+  assertColor(200, 100, 100, timeline.render(6500));
+  TEST_ASSERT_TRUE(timeline.playing());
+
+  // 最後のキーフレームの色で止まる
+  assertColor(200, 100, 200, timeline.render(7000));
+  TEST_ASSERT_FALSE(timeline.playing());
+}
+
+void test_hold_before_first_keyframe() {
+  Timeline timeline;
+  timeline.append(key(500, 10, 20, 30));
+  timeline.append(key(1000, 50, 60, 70));
+  timeline.play(0, false);
+  assertColor(10, 20, 30, timeline.render(0));
+  assertColor(10, 20, 30, timeline.render(499));
+  assertColor(30, 40, 50, timeline.render(750));
+}
+
+// 区間の補間方法は向かう先のキーフレームのもの
+void test_segment_uses_target_easing() {
+  Timeline timeline;
+  timeline.append(key(0, 0, 0, 0));
+  timeline.append(key(1000, 255, 255, 255, EASE_STEP));
+  timeline.append(key(2000, 0, 0, 0, EASE_LINEAR));
+  timeline.play(0, false);
+  assertColor(0, 0, 0, timeline.render(999));
+  assertColor(255, 255, 255, timeline.render(1000));
+  TEST_ASSERT_UINT8_WITHIN(1, 128, timeline.render(1500).r);
+}
+
+void test_loop_wraps_around() {
+  Timeline timeline;
+  timeline.append(key(0, 0, 0, 0));
+  timeline.append(key(1000, 100, 0, 0));
+  timeline.play(0, true);
+
+  assertColor(50, 0, 0, timeline.render(500));
+  assertColor(75, 0, 0, timeline.render(750));
+  // 2周目の最初に戻る
+  assertColor(0, 0, 0, timeline.render(1000));
+  assertColor(50, 0, 0, timeline.render(1500));
+  assertColor(50, 0, 0, timeline.render(10500));
+  TEST_ASSERT_TRUE(timeline.playing());
+}
+
+// millis() が1周しても再生開始からの経過時間で補間する
+void test_playback_across_clock_wrap() {
+  Timeline timeline;
+  timeline.append(key(0, 0, 0, 0));
+  timeline.append(key(1000, 100, 0, 0));
+  uint32_t start = UINT32_MAX - 499;
+  timeline.play(start, false);
+  assertColor(50, 0, 0, timeline.render(start + 500)); // 0 に戻った時刻
+  assertColor(100, 0, 0, timeline.render(start + 1000));
+  TEST_ASSERT_FALSE(timeline.playing());
+}
+
+void test_clear_stops_playback() {
+  Timeline timeline;
+  timeline.append(key(0, 1, 2, 3));
+  timeline.append(key(1000, 4, 5, 6));
+  timeline.play(0, true);
+  timeline.clear();
+  TEST_ASSERT_FALSE(timeline.playing());
+  TEST_ASSERT_EQUAL(0, timeline.size());
+  assertColor(0, 0, 0, timeline.render(500));
+
+  // 削除後に追加したキーフレームで再生し直せる
+  timeline.append(key(0, 7, 8, 9));
+  TEST_ASSERT_TRUE(timeline.play(0, false));
+  assertColor(7, 8, 9, timeline.render(100));
+  TEST_ASSERT_FALSE(timeline.playing());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_append_rejects_out_of_order_and_full);
+  RUN_TEST(test_play_needs_keyframes);
+  RUN_TEST(test_linear_interpolation_and_stop_at_end);
+  RUN_TEST(test_hold_before_first_keyframe);
+  RUN_TEST(test_segment_uses_target_easing);
+  RUN_TEST(test_loop_wraps_around);
+  RUN_TEST(test_playback_across_clock_wrap);
+  RUN_TEST(test_clear_stops_playback);
+  return UNITY_END();
+}